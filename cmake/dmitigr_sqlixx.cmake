@@ -25,12 +25,24 @@ dmitigr_cpplipa_set_library_info(sqlixx 1 0 0 "SQLite API")
 # ------------------------------------------------------------------------------
 
 set(dmitigr_sqlixx_headers
+  blob_store.hpp
+  bulk_load.hpp
+  capture.hpp
   connection.hpp
+  connection_factory.hpp
+  connection_options.hpp
   conversions.hpp
   data.hpp
   errctg.hpp
   exceptions.hpp
+  file_ingestion.hpp
+  keyset_cursor.hpp
+  lob_store.hpp
+  migration_runner.hpp
+  read_only_connection.hpp
+  result_set.hpp
   statement.hpp
+  statement_catalog.hpp
   )
 
 set(dmitigr_sqlixx_implementations
@@ -53,6 +65,8 @@ endif()
 # ------------------------------------------------------------------------------
 
 if(DMITIGR_CPPLIPA_TESTS)
-  set(dmitigr_sqlixx_tests test)
+  set(dmitigr_sqlixx_tests test alloc latency_vfs
+    advisor benchcmp benchmark_concurrency benchmark_lookaside benchmark_statement
+    benchmark_tail_latency ingest replay ycsb)
   set(dmitigr_sqlixx_tests_target_link_libraries dmitigr_base)
 endif()
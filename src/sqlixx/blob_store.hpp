@@ -0,0 +1,524 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_BLOB_STORE_HPP
+#define DMITIGR_SQLIXX_BLOB_STORE_HPP
+
+#include "connection.hpp"
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/// A 128-bit hash of the content stored in Blob_store.
+struct Blob_hash final {
+  /// The bytes of the hash.
+  std::array<unsigned char, 16> bytes{};
+
+  /// @returns The hexadecimal representation of the hash.
+  std::string to_string() const
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(bytes.size() * 2);
+    for (const unsigned char b : bytes) {
+      result += digits[b >> 4];
+      result += digits[b & 0xf];
+    }
+    return result;
+  }
+
+  /// @returns `true` if this instance equals to `rhs`.
+  bool operator==(const Blob_hash& rhs) const noexcept
+  {
+    return bytes == rhs.bytes;
+  }
+
+  /// @returns `!(*this == rhs)`.
+  bool operator!=(const Blob_hash& rhs) const noexcept
+  {
+    return !(*this == rhs);
+  }
+};
+
+/**
+ * @returns The 128-bit hash of `data` of `size` bytes.
+ *
+ * @details The hash is MurmurHash3_x64_128 with zero seed, which processes
+ * 16 bytes per iteration.
+ */
+inline Blob_hash blob_hash(const void* const data, const std::size_t size) noexcept
+{
+  const auto rotl = [](const std::uint64_t x, const int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  };
+  const auto fmix = [](std::uint64_t k)
+  {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+  };
+  const auto read = [](const unsigned char* const p)
+  {
+    std::uint64_t result{};
+    for (int i = 7; i >= 0; --i)
+      result = (result << 8) | p[i];
+    return result;
+  };
+
+  constexpr std::uint64_t c1{0x87c37b91114253d5ull};
+  constexpr std::uint64_t c2{0x4cf5ad432745937full};
+  const auto* const bytes = static_cast<const unsigned char*>(data);
+  const std::size_t block_count = size / 16;
+  std::uint64_t h1{};
+  std::uint64_t h2{};
+  for (std::size_t i = 0; i < block_count; ++i) {
+    std::uint64_t k1 = read(bytes + i * 16);
+    std::uint64_t k2 = read(bytes + i * 16 + 8);
+    k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  const auto* const tail = bytes + block_count * 16;
+  const std::size_t tail_size = size & 15;
+  std::uint64_t k1{};
+  std::uint64_t k2{};
+  for (std::size_t i = tail_size; i > 8; --i)
+    k2 = (k2 << 8) | tail[i - 1];
+  if (tail_size > 8) {
+    k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+  }
+  for (std::size_t i = std::min<std::size_t>(tail_size, 8); i > 0; --i)
+    k1 = (k1 << 8) | tail[i - 1];
+  if (tail_size) {
+    k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= size; h2 ^= size;
+  h1 += h2; h2 += h1;
+  h1 = fmix(h1); h2 = fmix(h2);
+  h1 += h2; h2 += h1;
+
+  Blob_hash result;
+  for (int i = 0; i < 8; ++i) {
+    result.bytes[static_cast<std::size_t>(i)] =
+      static_cast<unsigned char>(h1 >> (8 * i));
+    result.bytes[static_cast<std::size_t>(i + 8)] =
+      static_cast<unsigned char>(h2 >> (8 * i));
+  }
+  return result;
+}
+
+/// The options of Blob_store.
+struct Blob_store_options final {
+  /**
+   * Whether to split the content into the chunks by using the content-defined
+   * chunking, so the equal parts of different contents (e.g. the versions of
+   * a file) are stored once. Otherwise, only the equal contents are stored
+   * once.
+   */
+  bool is_chunking_enabled{};
+
+  /// The minimum size of chunk.
+  std::size_t min_chunk_size{2048};
+
+  /// The average size of chunk. Must be a power of two greater than one.
+  std::size_t average_chunk_size{8192};
+
+  /// The maximum size of chunk.
+  std::size_t max_chunk_size{65536};
+};
+
+/**
+ * @brief A content-addressed store of blobs.
+ *
+ * @details Each content is identified by its 128-bit hash, and is stored once
+ * regardless of the number of times it's put, so putting a duplicate costs
+ * reading it for comparison and the update of its reference count, but no
+ * writing of the content. The content is removed when the last
+ * reference is released. The contents are stored as the sequences of chunks,
+ * which are deduplicated as well. The store consists of two tables:
+ *
+ * @code
+ * <name>(hash blob primary key, refs integer, size integer, chunks blob)
+ * <name>_chunks(hash blob primary key, refs integer, data blob)
+ * @endcode
+ *
+ * where `chunks` is the concatenation of the hashes of the chunks.
+ *
+ * @remarks The instance must not outlive the connection.
+ */
+class Blob_store final {
+public:
+  /// The default name of the table.
+  static constexpr const char* default_name{"sqlixx_blobs"};
+
+  /**
+   * @brief Creates the tables (if not exist) and prepares the statements.
+   *
+   * @par Requires
+   * `connection.handle()`.
+   */
+  explicit Blob_store(Connection& connection, Blob_store_options options = {},
+    const std::string& name = default_name)
+    : connection_{&connection}
+    , options_{std::move(options)}
+  {
+    const auto& o = options_;
+    if (!(0 < o.min_chunk_size && o.min_chunk_size <= o.average_chunk_size &&
+        2 <= o.average_chunk_size && o.average_chunk_size <= o.max_chunk_size &&
+        !(o.average_chunk_size & (o.average_chunk_size - 1))))
+      throw Exception{"cannot create blob store with invalid chunk sizes"};
+
+    const auto blobs = detail::quoted_identifier(name);
+    const auto chunks = detail::quoted_identifier(name + "_chunks");
+    connection.execute_script("create table if not exists " + blobs +
+      "(hash blob primary key, refs integer not null, size integer not null,"
+      " chunks blob not null) without rowid;"
+      " create table if not exists " + chunks +
+      "(hash blob primary key, refs integer not null, data blob not null)"
+      " without rowid");
+    add_ref_ = connection.prepare("update " + blobs +
+      " set refs = refs + 1 where hash = ?");
+    insert_ = connection.prepare("insert into " + blobs + " values(?, 1, ?, ?)");
+    release_ = connection.prepare("update " + blobs +
+      " set refs = refs - 1 where hash = ?");
+    delete_ = connection.prepare("delete from " + blobs + " where hash = ?");
+    select_ = connection.prepare("select refs, size, chunks from " + blobs +
+      " where hash = ?");
+    add_chunk_ref_ = connection.prepare("update " + chunks +
+      " set refs = refs + 1 where hash = ?");
+    insert_chunk_ = connection.prepare("insert into " + chunks +
+      " values(?, 1, ?)");
+    release_chunk_ = connection.prepare("update " + chunks +
+      " set refs = refs - 1 where hash = ?");
+    delete_chunk_ = connection.prepare("delete from " + chunks +
+      " where hash = ? and refs <= 0");
+    select_chunk_ = connection.prepare("select data from " + chunks +
+      " where hash = ?");
+  }
+
+  /// @returns The options.
+  const Blob_store_options& options() const noexcept
+  {
+    return options_;
+  }
+
+  /**
+   * @brief Stores the `data` of `size` bytes, or adds the reference to it if
+   * it's already stored.
+   *
+   * @details Since the hash is not cryptographic, the stored content (and
+   * each stored chunk) with the same hash is compared with `data` before
+   * adding the reference to it.
+   *
+   * @returns The hash of the data.
+   *
+   * @throws Exception if the content or the chunk with the same hash but
+   * different bytes is stored (i.e. on hash collision).
+   */
+  Blob_hash put(const void* const data, const std::size_t size)
+  {
+    const auto result = blob_hash(data, size);
+    const auto* const bytes = static_cast<const unsigned char*>(data);
+    with_savepoint__([&]
+    {
+      bool is_found{};
+      sqlite3_int64 stored_size{};
+      std::vector<unsigned char> chunks;
+      select_.execute([&](const Statement& s)
+      {
+        is_found = true;
+        stored_size = s.result<sqlite3_int64>(1);
+        chunks = s.result<std::vector<unsigned char>>(2);
+      }, result.bytes);
+      if (is_found) {
+        if (stored_size != static_cast<sqlite3_int64>(size) ||
+          !is_content_equal__(chunks, bytes, size))
+          throw Exception{"blob store hash collision of " + result.to_string()};
+        add_ref_.execute(result.bytes);
+        return;
+      }
+
+      std::size_t offset{};
+      do {
+        const auto chunk_size = options_.is_chunking_enabled ?
+          next_chunk_size__(bytes + offset, size - offset) : size;
+        const auto hash = chunk_size == size ? result :
+          blob_hash(bytes + offset, chunk_size);
+        chunks.insert(chunks.end(), hash.bytes.begin(), hash.bytes.end());
+        if (const auto is_equal = is_chunk_equal__(hash.bytes, bytes + offset,
+            chunk_size)) {
+          if (!*is_equal)
+            throw Exception{"blob store chunk hash collision of " +
+              hash.to_string()};
+          add_chunk_ref_.execute(hash.bytes);
+        } else {
+          const Span<unsigned char> chunk{bytes + offset, chunk_size};
+          insert_chunk_.execute(hash.bytes, chunk);
+        }
+        offset += chunk_size;
+      } while (offset < size);
+      insert_.execute(result.bytes, static_cast<sqlite3_int64>(size), chunks);
+    });
+    return result;
+  }
+
+  /// @overload
+  Blob_hash put(const Blob& data)
+  {
+    return put(data.data(), static_cast<std::size_t>(data.size()));
+  }
+
+  /**
+   * @brief Adds the reference to the stored content.
+   *
+   * @returns `false` if no content with the `hash` is stored.
+   */
+  bool add_ref(const Blob_hash& hash)
+  {
+    add_ref_.execute(hash.bytes);
+    return changes__();
+  }
+
+  /**
+   * @brief Releases the reference to the stored content, and removes the
+   * content if it was the last reference.
+   *
+   * @returns `false` if no content with the `hash` is stored.
+   */
+  bool release(const Blob_hash& hash)
+  {
+    bool result{};
+    with_savepoint__([&]
+    {
+      sqlite3_int64 refs{};
+      std::vector<unsigned char> chunks;
+      select_.execute([&](const Statement& s)
+      {
+        result = true;
+        refs = s.result<sqlite3_int64>(0);
+        chunks = s.result<std::vector<unsigned char>>(2);
+      }, hash.bytes);
+      if (!result)
+        return;
+      else if (refs > 1) {
+        release_.execute(hash.bytes);
+        return;
+      }
+
+      delete_.execute(hash.bytes);
+      for (std::size_t offset{}; offset < chunks.size(); offset += 16) {
+        std::array<unsigned char, 16> chunk;
+        std::memcpy(chunk.data(), chunks.data() + offset, chunk.size());
+        release_chunk_.execute(chunk);
+        delete_chunk_.execute(chunk);
+      }
+    });
+    return result;
+  }
+
+  /// @returns The content, or `std::nullopt` if no content with the `hash`.
+  std::optional<std::vector<std::byte>> get(const Blob_hash& hash)
+  {
+    std::optional<std::vector<std::byte>> result;
+    std::vector<unsigned char> chunks;
+    select_.execute([&](const Statement& s)
+    {
+      result.emplace();
+      result->reserve(static_cast<std::size_t>(s.result<sqlite3_int64>(1)));
+      chunks = s.result<std::vector<unsigned char>>(2);
+    }, hash.bytes);
+    for (std::size_t offset{}; offset < chunks.size(); offset += 16) {
+      std::array<unsigned char, 16> chunk;
+      std::memcpy(chunk.data(), chunks.data() + offset, chunk.size());
+      bool is_found{};
+      select_chunk_.execute([&](const Statement& s)
+      {
+        const auto data = s.result<Blob>(0);
+        const auto* const b = static_cast<const std::byte*>(data.data());
+        result->insert(result->end(), b, b + data.size());
+        is_found = true;
+      }, chunk);
+      if (!is_found)
+        throw Exception{"blob store chunk of " + hash.to_string() +
+          " is missing"};
+    }
+    return result;
+  }
+
+  /// @returns The number of references to the content, or `0` if not stored.
+  sqlite3_int64 ref_count(const Blob_hash& hash)
+  {
+    sqlite3_int64 result{};
+    select_.execute([&result](const Statement& s)
+    {
+      result = s.result<sqlite3_int64>(0);
+    }, hash.bytes);
+    return result;
+  }
+
+private:
+  Connection* connection_{};
+  Blob_store_options options_;
+  Statement add_ref_;
+  Statement insert_;
+  Statement release_;
+  Statement delete_;
+  Statement select_;
+  Statement add_chunk_ref_;
+  Statement insert_chunk_;
+  Statement release_chunk_;
+  Statement delete_chunk_;
+  Statement select_chunk_;
+
+  bool changes__() const noexcept
+  {
+    return sqlite3_changes(connection_->handle()) > 0;
+  }
+
+  /**
+   * @returns `std::nullopt` if no chunk with the `hash` is stored, or whether
+   * the stored chunk equals to the `data` of `size` bytes otherwise.
+   */
+  std::optional<bool> is_chunk_equal__(const std::array<unsigned char, 16>& hash,
+    const unsigned char* const data, const std::size_t size)
+  {
+    std::optional<bool> result;
+    select_chunk_.execute([&](const Statement& s)
+    {
+      const auto chunk = s.result<Blob>(0);
+      result = static_cast<std::size_t>(chunk.size()) == size &&
+        (!size || !std::memcmp(chunk.data(), data, size));
+    }, hash);
+    return result;
+  }
+
+  /// @returns `true` if the content of the `chunks` equals to the `data`.
+  bool is_content_equal__(const std::vector<unsigned char>& chunks,
+    const unsigned char* const data, const std::size_t size)
+  {
+    std::size_t offset{};
+    for (std::size_t i{}; i < chunks.size(); i += 16) {
+      std::array<unsigned char, 16> hash;
+      std::memcpy(hash.data(), chunks.data() + i, hash.size());
+      bool is_equal{};
+      select_chunk_.execute([&](const Statement& s)
+      {
+        const auto chunk = s.result<Blob>(0);
+        const auto chunk_size = static_cast<std::size_t>(chunk.size());
+        is_equal = chunk_size <= size - offset && (!chunk_size ||
+          !std::memcmp(chunk.data(), data + offset, chunk_size));
+        offset += chunk_size;
+      }, hash);
+      if (!is_equal)
+        return false;
+    }
+    return offset == size;
+  }
+
+  template<typename F>
+  void with_savepoint__(F&& callback)
+  {
+    connection_->execute("savepoint sqlixx_blob_store");
+    try {
+      callback();
+    } catch (...) {
+      try {
+        // The failed statement prevents the rollback, and the chunk bound
+        // without copying must not outlive the caller's data.
+        for (auto* const s : {&add_ref_, &insert_, &release_, &delete_,
+            &select_, &add_chunk_ref_, &insert_chunk_, &release_chunk_,
+            &delete_chunk_, &select_chunk_})
+          s->reset();
+        insert_chunk_.bind_null();
+        connection_->execute("rollback to sqlixx_blob_store");
+        connection_->execute("release sqlixx_blob_store");
+      } catch (...) {
+        std::throw_with_nested(Exception{"SQLite ROLLBACK TO failed"});
+      }
+      throw;
+    }
+    connection_->execute("release sqlixx_blob_store");
+  }
+
+  /**
+   * @returns The size of the chunk at the beginning of `data` found by using
+   * the Gear rolling hash, which is reset at each chunk boundary, so the
+   * boundaries depend only on the content around them.
+   */
+  std::size_t next_chunk_size__(const unsigned char* const data,
+    const std::size_t size) const noexcept
+  {
+    static const auto gear = []
+    {
+      std::array<std::uint64_t, 256> result{};
+      std::uint64_t state{0x9e3779b97f4a7c15ull};
+      for (auto& value : result) { // splitmix64
+        auto z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        value = z ^ (z >> 31);
+      }
+      return result;
+    }();
+
+    if (size <= options_.min_chunk_size)
+      return size;
+    const auto mask = static_cast<std::uint64_t>(options_.average_chunk_size - 1)
+      << (64 - bit_width__(options_.average_chunk_size - 1));
+    const auto end = std::min(size, options_.max_chunk_size);
+    std::uint64_t hash{};
+    for (std::size_t i = options_.min_chunk_size; i < end; ++i) {
+      hash = (hash << 1) + gear[data[i]];
+      if (!(hash & mask))
+        return i + 1;
+    }
+    return end;
+  }
+
+  static int bit_width__(std::size_t value) noexcept
+  {
+    int result{};
+    for (; value; value >>= 1)
+      ++result;
+    return result;
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_BLOB_STORE_HPP
@@ -0,0 +1,1093 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_BULK_LOAD_HPP
+#define DMITIGR_SQLIXX_BULK_LOAD_HPP
+
+#include "connection.hpp"
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+#include "../base/assert.hpp"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+namespace detail {
+/**
+ * @brief A buffer of rows of SQLite values.
+ *
+ * @details The values passed are converted to the SQLite values they are
+ * bound as by selecting them, so any type for which Conversions is provided
+ * can be buffered. Each row is stored as a sequence of values, each of which
+ * is the type byte followed by the 8-byte integer or real, or by the 4-byte
+ * size and the bytes of the text or the blob.
+ */
+class Row_buffer final {
+public:
+  /// The constructor.
+  Row_buffer(Connection& connection, const int value_count)
+    : value_count_{value_count}
+  {
+    DMITIGR_ASSERT(value_count > 0);
+    std::string select{"select ?"};
+    for (int i = 1; i < value_count; ++i)
+      select += ", ?";
+    select_ = connection.prepare(select);
+  }
+
+  /// Appends the row of `values`.
+  template<typename ... Types>
+  void append(Types&& ... values)
+  {
+    select_.execute([this](const Statement& s)
+    {
+      append__(s);
+    }, std::forward<Types>(values)...);
+  }
+
+  /// @returns The number of rows.
+  std::size_t size() const noexcept
+  {
+    return offsets_.size();
+  }
+
+  /// @returns The size of the rows in memory.
+  std::size_t size_bytes() const noexcept
+  {
+    return buffer_.size() + offsets_.size() * sizeof(std::size_t);
+  }
+
+  /// @returns The row by the `index`.
+  const char* row(const std::size_t index) const noexcept
+  {
+    return buffer_.data() + offsets_[index];
+  }
+
+  /// Sorts the rows by using the `less` predicate of two rows.
+  template<typename F>
+  void sort(F&& less)
+  {
+    std::stable_sort(offsets_.begin(), offsets_.end(),
+      [this, &less](const std::size_t lhs, const std::size_t rhs)
+      {
+        return less(buffer_.data() + lhs, buffer_.data() + rhs);
+      });
+  }
+
+  /// Removes all the rows.
+  void clear() noexcept
+  {
+    buffer_.clear();
+    offsets_.clear();
+  }
+
+  /// @returns The size of the `row` in bytes.
+  std::size_t row_size(const char* const row) const noexcept
+  {
+    const char* value = row;
+    for (int i = 0; i < value_count_; ++i)
+      value = next_value(value);
+    return static_cast<std::size_t>(value - row);
+  }
+
+  /// Binds the values of the `row` to the parameters of the `statement`.
+  void bind(Statement& statement, const char* value) const
+  {
+    for (int i = 0; i < value_count_; ++i, value = next_value(value)) {
+      switch (*value) {
+      case SQLITE_INTEGER:
+        statement.bind(i, read__<sqlite3_int64>(value + 1));
+        break;
+      case SQLITE_FLOAT:
+        statement.bind(i, read__<double>(value + 1));
+        break;
+      case SQLITE_TEXT: {
+        const std::string_view text{value + 5, read__<std::uint32_t>(value + 1)};
+        statement.bind(i, text);
+        break;
+      }
+      case SQLITE_BLOB: {
+        const Span<char> blob{value + 5, read__<std::uint32_t>(value + 1)};
+        statement.bind(i, blob);
+        break;
+      }
+      default:
+        statement.bind_null(i);
+      }
+    }
+  }
+
+  /// @returns The values of the `row`.
+  std::vector<Value> values(const char* const row)
+  {
+    std::vector<Value> result;
+    select_.reset();
+    bind(select_, row);
+    select_.execute([&result](const Statement& s)
+    {
+      const int count = s.column_count();
+      result.reserve(static_cast<std::size_t>(count));
+      for (int i = 0; i < count; ++i)
+        result.push_back(s.result<Value>(i));
+    });
+    return result;
+  }
+
+  /// @returns The pointer to the value which follows the `value`.
+  static const char* next_value(const char* const value) noexcept
+  {
+    switch (*value) {
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+      return value + 1 + 8;
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:
+      return value + 1 + 4 + read__<std::uint32_t>(value + 1);
+    default:
+      return value + 1;
+    }
+  }
+
+  /// @returns The pointer to the value of the `row` by the `index`.
+  static const char* value(const char* row, int index) noexcept
+  {
+    for (; index > 0; --index)
+      row = next_value(row);
+    return row;
+  }
+
+  /**
+   * @returns The negative, zero or positive value as `lhs` is less, equal or
+   * greater than `rhs` by the SQLite rules with the binary collation.
+   */
+  static int compare_values(const char* const lhs, const char* const rhs) noexcept
+  {
+    // NULL < INTEGER, FLOAT < TEXT < BLOB
+    const auto rank = [](const char type)
+    {
+      return type == SQLITE_NULL ? 0 : type == SQLITE_TEXT ? 2 :
+        type == SQLITE_BLOB ? 3 : 1;
+    };
+    if (const int r = rank(*lhs) - rank(*rhs))
+      return r;
+
+    switch (rank(*lhs)) {
+    case 0:
+      return 0;
+    case 1:
+      if (*lhs == SQLITE_INTEGER && *rhs == SQLITE_INTEGER) {
+        const auto l = read__<sqlite3_int64>(lhs + 1);
+        const auto r = read__<sqlite3_int64>(rhs + 1);
+        return (l > r) - (l < r);
+      } else {
+        const auto number = [](const char* const v)
+        {
+          return *v == SQLITE_INTEGER ?
+            static_cast<double>(read__<sqlite3_int64>(v + 1)) :
+            read__<double>(v + 1);
+        };
+        const double l = number(lhs);
+        const double r = number(rhs);
+        return (l > r) - (l < r);
+      }
+    default: {
+      const auto lsize = read__<std::uint32_t>(lhs + 1);
+      const auto rsize = read__<std::uint32_t>(rhs + 1);
+      if (const int r = std::memcmp(lhs + 5, rhs + 5, std::min(lsize, rsize)))
+        return r;
+      return (lsize > rsize) - (lsize < rsize);
+    }
+    }
+  }
+
+private:
+  int value_count_{};
+  Statement select_;
+  std::vector<char> buffer_;
+  std::vector<std::size_t> offsets_;
+
+  template<typename T>
+  void append_bytes__(const T value)
+  {
+    const auto* const bytes = reinterpret_cast<const char*>(&value);
+    buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+  }
+
+  template<typename T>
+  static T read__(const char* const bytes) noexcept
+  {
+    T result;
+    std::memcpy(&result, bytes, sizeof(T));
+    return result;
+  }
+
+  void append__(const Statement& statement)
+  {
+    sqlite3_stmt* const handle = statement.handle();
+    offsets_.push_back(buffer_.size());
+    for (int i = 0; i < value_count_; ++i) {
+      const int type = sqlite3_column_type(handle, i);
+      buffer_.push_back(static_cast<char>(type));
+      switch (type) {
+      case SQLITE_INTEGER:
+        append_bytes__(sqlite3_column_int64(handle, i));
+        break;
+      case SQLITE_FLOAT:
+        append_bytes__(sqlite3_column_double(handle, i));
+        break;
+      case SQLITE_TEXT:
+      case SQLITE_BLOB: {
+        const auto* const data = static_cast<const char*>(type == SQLITE_TEXT ?
+          static_cast<const void*>(sqlite3_column_text(handle, i)) :
+          sqlite3_column_blob(handle, i));
+        const auto size = static_cast<std::uint32_t>(
+          sqlite3_column_bytes(handle, i));
+        append_bytes__(size);
+        if (size)
+          buffer_.insert(buffer_.end(), data, data + size);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+};
+} // namespace detail
+
+/**
+ * @brief The options of sorting of the rows by Bulk_inserter.
+ *
+ * @details Inserting the rows in the order of the key of the B-tree avoids
+ * page splits and random I/O, so the database file is denser and loading is
+ * faster.
+ */
+struct Bulk_sort_options final {
+  /**
+   * The zero-based indexes of the parameters of the insert statement which
+   * make up the key to sort by (usually, the primary key).
+   */
+  std::vector<int> key;
+
+  /**
+   * The maximum size of the rows buffered in memory. When exceeded, the
+   * buffered rows are sorted and spilled to a temporary file as a run.
+   */
+  std::size_t memory_budget{std::size_t{64} << 20};
+};
+
+/**
+ * @brief An inserter which commits the rows in batches.
+ *
+ * @details The transaction is begun upon the first insertion of a batch, and
+ * is committed when the batch is full or upon `flush()`.
+ *
+ * If the sort options are specified, the rows are buffered instead of being
+ * inserted immediately, and are inserted in the order of the key upon
+ * `flush()` (in batches as well). The rows which don't fit the memory budget
+ * are sorted and spilled to temporary files as runs, which are merged upon
+ * `flush()`. The values are buffered as the SQLite values they are bound as,
+ * and are compared by the SQLite rules with the binary collation.
+ *
+ * @remarks The instance must not outlive the connection.
+ */
+class Bulk_inserter final {
+public:
+  /// The default number of rows per transaction.
+  static constexpr std::size_t default_batch_size{10000};
+
+  /**
+   * @brief The destructor. Rolls back the batch which is not flushed and
+   * discards the buffered rows.
+   */
+  ~Bulk_inserter()
+  {
+    if (batch_count_ && connection_->is_transaction_active()) {
+      try {
+        insert_.reset(); // the failed statement prevents the rollback
+        connection_->execute("rollback");
+      } catch (...) {}
+    }
+  }
+
+  /**
+   * @brief The constructor.
+   *
+   * @param insert The statement to execute for each row.
+   * @param sort The options of sorting of the rows, if any.
+   *
+   * @par Requires
+   * `connection.handle() && !connection.is_transaction_active() &&
+   * batch_size > 0`.
+   */
+  Bulk_inserter(Connection& connection, const std::string_view insert,
+    const std::size_t batch_size = default_batch_size,
+    std::optional<Bulk_sort_options> sort = {})
+    : connection_{&connection}
+    , insert_{connection.prepare(insert)}
+    , batch_size_{batch_size}
+    , sort_{std::move(sort)}
+  {
+    if (!batch_size_)
+      throw Exception{"cannot create bulk inserter with zero batch size"};
+    else if (connection.is_transaction_active())
+      throw Exception{"cannot create bulk inserter in transaction"};
+
+    if (sort_) {
+      const int count = insert_.parameter_count();
+      if (sort_->key.empty() || std::any_of(sort_->key.begin(), sort_->key.end(),
+          [count](const int i){ return i < 0 || i >= count; }))
+        throw Exception{"cannot create bulk inserter with invalid sort key"};
+      rows_.emplace(connection, count);
+    }
+  }
+
+  /// Non copy-constructible.
+  Bulk_inserter(const Bulk_inserter&) = delete;
+
+  /// Non copy-assignable.
+  Bulk_inserter& operator=(const Bulk_inserter&) = delete;
+
+  /// Non move-constructible.
+  Bulk_inserter(Bulk_inserter&&) = delete;
+
+  /// Non move-assignable.
+  Bulk_inserter& operator=(Bulk_inserter&&) = delete;
+
+  /// Inserts (or buffers if sorting) the row of `values`.
+  template<typename ... Types>
+  void insert(Types&& ... values)
+  {
+    if (sort_) {
+      rows_->append(std::forward<Types>(values)...);
+      if (rows_->size_bytes() > sort_->memory_budget)
+        spill__();
+      return;
+    }
+
+    begin_row__();
+    insert_.reset(); // otherwise the bindings of the failed row are reused
+    insert_.execute(std::forward<Types>(values)...);
+    end_row__();
+  }
+
+  /**
+   * @brief Inserts the buffered rows (if sorting) and commits the current
+   * batch.
+   *
+   * @details If the insertion of a buffered row fails, the rest of the
+   * buffered rows are discarded, and the rows inserted in the current batch
+   * are left uncommitted until the next `flush()`.
+   */
+  void flush()
+  {
+    if (sort_) {
+      try {
+        if (runs_.empty())
+          insert_sorted__();
+        else {
+          spill__();
+          merge_runs__();
+        }
+      } catch (...) {
+        // The rows already consumed from the runs cannot be restored.
+        runs_.clear();
+        rows_->clear();
+        throw;
+      }
+    }
+    commit__();
+  }
+
+  /// @returns The number of rows inserted.
+  std::uint64_t row_count() const noexcept
+  {
+    return row_count_;
+  }
+
+  /// @returns The number of rows per transaction.
+  std::size_t batch_size() const noexcept
+  {
+    return batch_size_;
+  }
+
+private:
+  using File = std::unique_ptr<std::FILE, int(*)(std::FILE*)>;
+
+  /// A run of rows spilled to the temporary file.
+  struct Run final {
+    File file{nullptr, &std::fclose};
+    std::vector<char> row;
+  };
+
+  Connection* connection_{};
+  Statement insert_;
+  std::size_t batch_size_{};
+  std::size_t batch_count_{};
+  std::uint64_t row_count_{};
+  std::optional<Bulk_sort_options> sort_;
+  std::optional<detail::Row_buffer> rows_;
+  std::vector<Run> runs_;
+
+  void begin_row__()
+  {
+    if (!batch_count_)
+      connection_->execute("begin");
+    ++batch_count_;
+  }
+
+  void end_row__()
+  {
+    ++row_count_;
+    if (batch_count_ == batch_size_)
+      commit__();
+  }
+
+  void commit__()
+  {
+    if (batch_count_) {
+      connection_->execute("commit");
+      batch_count_ = 0;
+    }
+  }
+
+  bool is_less__(const char* const lhs, const char* const rhs) const noexcept
+  {
+    for (const int i : sort_->key) {
+      if (const int r = detail::Row_buffer::compare_values(
+          detail::Row_buffer::value(lhs, i), detail::Row_buffer::value(rhs, i)))
+        return r < 0;
+    }
+    return false;
+  }
+
+  void sort_rows__()
+  {
+    rows_->sort([this](const char* const lhs, const char* const rhs)
+    {
+      return is_less__(lhs, rhs);
+    });
+  }
+
+  void insert_row__(const char* const row)
+  {
+    begin_row__();
+    insert_.reset();
+    rows_->bind(insert_, row);
+    insert_.execute();
+    end_row__();
+  }
+
+  void insert_sorted__()
+  {
+    sort_rows__();
+    for (std::size_t i = 0; i < rows_->size(); ++i)
+      insert_row__(rows_->row(i));
+    rows_->clear();
+  }
+
+  void spill__()
+  {
+    if (!rows_->size())
+      return;
+
+    sort_rows__();
+    Run run;
+    run.file.reset(std::tmpfile());
+    if (!run.file)
+      throw Exception{"cannot create temporary file for bulk inserter"};
+    for (std::size_t i = 0; i < rows_->size(); ++i) {
+      const char* const row = rows_->row(i);
+      const auto size = static_cast<std::uint32_t>(rows_->row_size(row));
+      if (std::fwrite(&size, sizeof(size), 1, run.file.get()) != 1 ||
+        std::fwrite(row, 1, size, run.file.get()) != size)
+        throw Exception{"cannot write temporary file of bulk inserter"};
+    }
+    if (std::fflush(run.file.get()))
+      throw Exception{"cannot write temporary file of bulk inserter"};
+    std::rewind(run.file.get());
+    runs_.push_back(std::move(run));
+    rows_->clear();
+  }
+
+  /// @returns `false` if the run is exhausted.
+  static bool read_row__(Run& run)
+  {
+    std::uint32_t size;
+    if (std::fread(&size, sizeof(size), 1, run.file.get()) != 1)
+      return false;
+    run.row.resize(size);
+    if (std::fread(run.row.data(), 1, size, run.file.get()) != size)
+      throw Exception{"cannot read temporary file of bulk inserter"};
+    return true;
+  }
+
+  void merge_runs__()
+  {
+    // The min-heap of the runs by their current rows.
+    const auto is_greater = [this](const Run* const lhs, const Run* const rhs)
+    {
+      return is_less__(rhs->row.data(), lhs->row.data());
+    };
+    std::vector<Run*> heap;
+    for (auto& run : runs_) {
+      if (read_row__(run))
+        heap.push_back(&run);
+    }
+    std::make_heap(heap.begin(), heap.end(), is_greater);
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), is_greater);
+      auto* const run = heap.back();
+      insert_row__(run->row.data());
+      if (read_row__(*run))
+        std::push_heap(heap.begin(), heap.end(), is_greater);
+      else
+        heap.pop_back();
+    }
+    runs_.clear();
+  }
+};
+
+/// A row rejected by Batch_executor.
+struct Failed_row final {
+  /// The zero-based ordinal of the row among the rows passed to the executor.
+  std::uint64_t index{};
+
+  /// The SQLite result code.
+  int code{};
+
+  /// The error message.
+  std::string message;
+
+  /// The values of the row.
+  std::vector<Value> values;
+};
+
+/**
+ * @brief An error-tolerant executor which commits the rows in batches.
+ *
+ * @details The rows are buffered and executed in a transaction per batch.
+ * Each batch is executed under a savepoint, so a clean batch costs just one
+ * savepoint. If a row fails, the changes are rolled back to the savepoint and
+ * the batch is bisected: both halves are executed under the nested savepoints
+ * recursively until the failing rows are isolated. The failing rows are
+ * reported by `failed_rows()` and the rest are committed, just as if the rows
+ * were executed one by one. Thus, a batch with a few bad rows costs about
+ * `log2(batch_size)` reexecutions of its rows per bad row instead of the
+ * reexecution of all of them row by row.
+ *
+ * Only the errors which are specific to the row (constraint violations, type
+ * mismatches, too big values and the errors raised by the SQL, e.g. by
+ * triggers) are isolated. The other errors (I/O errors, busy database etc)
+ * roll back the current batch and are rethrown.
+ *
+ * @remarks The instance must not outlive the connection.
+ */
+class Batch_executor final {
+public:
+  /// The default number of rows per transaction.
+  static constexpr std::size_t default_batch_size{10000};
+
+  /// The destructor. Discards the buffered rows.
+  ~Batch_executor() = default;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param sql The statement to execute for each row.
+   *
+   * @par Requires
+   * `connection.handle() && !connection.is_transaction_active() &&
+   * batch_size > 0`.
+   */
+  Batch_executor(Connection& connection, const std::string_view sql,
+    const std::size_t batch_size = default_batch_size)
+    : connection_{&connection}
+    , statement_{connection.prepare(sql)}
+    , batch_size_{batch_size}
+  {
+    if (!batch_size_)
+      throw Exception{"cannot create batch executor with zero batch size"};
+    else if (connection.is_transaction_active())
+      throw Exception{"cannot create batch executor in transaction"};
+    else if (!statement_.parameter_count())
+      throw Exception{"cannot create batch executor of statement without "
+        "parameters"};
+    rows_.emplace(connection, statement_.parameter_count());
+  }
+
+  /// Non copy-constructible.
+  Batch_executor(const Batch_executor&) = delete;
+
+  /// Non copy-assignable.
+  Batch_executor& operator=(const Batch_executor&) = delete;
+
+  /// Non move-constructible.
+  Batch_executor(Batch_executor&&) = delete;
+
+  /// Non move-assignable.
+  Batch_executor& operator=(Batch_executor&&) = delete;
+
+  /**
+   * @brief Buffers the row of `values`. Executes the batch if it's full.
+   *
+   * @see flush().
+   */
+  template<typename ... Types>
+  void execute(Types&& ... values)
+  {
+    rows_->append(std::forward<Types>(values)...);
+    if (rows_->size() == batch_size_)
+      flush();
+  }
+
+  /**
+   * @brief Executes the buffered rows in the transaction, isolates the failing
+   * rows and commits the rest.
+   *
+   * @par Exception safety guarantee
+   * Basic. If the error which is not specific to the row occurs, the batch is
+   * rolled back and discarded.
+   */
+  void flush()
+  {
+    const std::size_t size = rows_->size();
+    if (!size)
+      return;
+
+    const auto failed_count = failed_rows_.size();
+    const auto row_count = row_count_;
+    try {
+      connection_->execute("begin");
+      execute_range__(0, size);
+      connection_->execute("commit");
+    } catch (...) {
+      statement_.reset();
+      if (connection_->is_transaction_active()) {
+        try {
+          connection_->execute("rollback");
+        } catch (...) {}
+      }
+      failed_rows_.resize(failed_count);
+      row_count_ = row_count;
+      discard__(size);
+      throw;
+    }
+    discard__(size);
+  }
+
+  /// @returns The number of rows executed successfully and committed.
+  std::uint64_t row_count() const noexcept
+  {
+    return row_count_;
+  }
+
+  /// @returns The rows which are failed.
+  const std::vector<Failed_row>& failed_rows() const noexcept
+  {
+    return failed_rows_;
+  }
+
+  /// @returns The released failed rows.
+  std::vector<Failed_row> release_failed_rows() noexcept
+  {
+    std::vector<Failed_row> result;
+    failed_rows_.swap(result);
+    return result;
+  }
+
+  /// @returns The number of rows per transaction.
+  std::size_t batch_size() const noexcept
+  {
+    return batch_size_;
+  }
+
+private:
+  Connection* connection_{};
+  Statement statement_;
+  std::size_t batch_size_{};
+  std::uint64_t row_count_{};
+  std::uint64_t batch_offset_{};
+  std::optional<detail::Row_buffer> rows_;
+  std::vector<Failed_row> failed_rows_;
+
+  /// @returns `true` if the error `code` is specific to the row.
+  static bool is_row_error__(const int code) noexcept
+  {
+    switch (code & 0xff) {
+    case SQLITE_CONSTRAINT:
+    case SQLITE_MISMATCH:
+    case SQLITE_TOOBIG:
+    case SQLITE_RANGE:
+    case SQLITE_ERROR:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  /// Executes the rows of range [begin, end) under the savepoint.
+  void execute_range__(const std::size_t begin, const std::size_t end)
+  {
+    connection_->execute("savepoint sqlixx_batch");
+    try {
+      for (auto i = begin; i < end; ++i) {
+        statement_.reset();
+        rows_->bind(statement_, rows_->row(i));
+        statement_.execute();
+      }
+    } catch (const Sqlite_exception& e) {
+      const int code = e.condition().value();
+      if (!is_row_error__(code))
+        throw;
+
+      statement_.reset(); // the failed statement prevents the rollback
+      connection_->execute("rollback to sqlixx_batch");
+      if (end - begin == 1) {
+        const char* const row = rows_->row(begin);
+        failed_rows_.push_back(Failed_row{batch_offset_ + begin, code,
+          e.what(), rows_->values(row)});
+      } else {
+        const auto middle = begin + (end - begin) / 2;
+        execute_range__(begin, middle);
+        execute_range__(middle, end);
+      }
+      connection_->execute("release sqlixx_batch");
+      return;
+    }
+    connection_->execute("release sqlixx_batch");
+    row_count_ += end - begin;
+  }
+
+  void discard__(const std::size_t size) noexcept
+  {
+    batch_offset_ += size;
+    rows_->clear();
+  }
+};
+
+/// The durations of the phases of Bulk_load_session in seconds.
+struct Bulk_load_timings final {
+  /// Capturing the schema, dropping the indexes and triggers, setting pragmas.
+  double prepare{};
+
+  /// Loading (from the end of preparation until `finish()`).
+  double load{};
+
+  /// Recreating the indexes.
+  double index{};
+
+  /// Recreating the triggers and restoring pragmas.
+  double restore{};
+};
+
+/**
+ * @brief A bulk load session.
+ *
+ * @details Upon construction, the session captures the DDL of the indexes and
+ * the triggers of the tables to load from `sqlite_master`, saves it to the
+ * table `objects_table`, drops them, keeps the rollback journal in memory
+ * and turns off the synchronization. Upon `finish()` or destruction, the
+ * indexes and triggers are recreated and the settings are restored (an active
+ * transaction is rolled back first upon destruction), so the database schema
+ * is restored even if the load fails. Creating indexes on the loaded data is
+ * much faster than maintaining them upon each insertion.
+ *
+ * If the process crashes during the session, the DDL saved is not lost: the
+ * next session recreates the objects which are still missing along with its
+ * own ones. The DDL of the objects which cannot be recreated (e.g. the unique
+ * index if the duplicates are loaded) is kept in the table as well.
+ *
+ * @warning With the rollback journal kept in memory and the synchronization
+ * turned off, the transactions can be rolled back, but a crash during the
+ * session may corrupt the database. So the session is intended for the loads
+ * which can be repeated from scratch, e.g. nightly full reloads.
+ *
+ * @remarks The instance must not outlive the connection.
+ */
+class Bulk_load_session final {
+public:
+  /// The name of the table of the DDL of the dropped objects.
+  static constexpr const char* objects_table{"sqlixx_bulk_load_objects"};
+
+  /// A schema object dropped for the session.
+  struct Schema_object final {
+    /// The type (`index` or `trigger`).
+    std::string type;
+    /// The name.
+    std::string name;
+    /// The DDL.
+    std::string sql;
+  };
+
+  /**
+   * @brief The destructor. Rolls back the active transaction and calls
+   * `finish()` if not called, ignoring the errors.
+   */
+  ~Bulk_load_session()
+  {
+    if (is_active_) {
+      try {
+        if (connection_->is_transaction_active())
+          connection_->execute("rollback");
+      } catch (...) {}
+      try {
+        finish();
+      } catch (...) {}
+    }
+  }
+
+  /**
+   * @brief Starts the session.
+   *
+   * @param tables The tables to load, or empty vector to load all the tables.
+   *
+   * @par Requires
+   * `connection.handle() && !connection.is_transaction_active()`.
+   */
+  explicit Bulk_load_session(Connection& connection,
+    const std::vector<std::string>& tables = {})
+    : connection_{&connection}
+  {
+    if (connection.is_transaction_active())
+      throw Exception{"cannot start bulk load session in transaction"};
+
+    const auto start = Clock::now();
+    connection.execute([this](const Statement& s)
+    {
+      journal_mode_ = s.result<std::string>(0);
+    }, "pragma journal_mode");
+    connection.execute([this](const Statement& s)
+    {
+      synchronous_ = s.result<int>(0);
+    }, "pragma synchronous");
+
+    connection.execute("begin");
+    connection.with_rollback_on_error([&]
+    {
+      const auto saved = detail::quoted_identifier(objects_table);
+      connection.execute("create table if not exists " + saved +
+        "(name text primary key, type text not null, sql text not null)");
+
+      // The objects saved by the sessions which are not finished (because of
+      // crashes) are recreated by this session unless already exist.
+      std::vector<std::string> existing;
+      connection.execute([&](const Statement& s)
+      {
+        if (s.result<int>(3))
+          existing.push_back(s.result<std::string>(1));
+        else
+          objects_.push_back({s.result<std::string>(0),
+            s.result<std::string>(1), s.result<std::string>(2)});
+      }, "select type, name, sql, exists(select 1 from sqlite_master m"
+        " where m.name = o.name) from " + saved + " o order by type, name");
+      for (const auto& name : existing)
+        connection.execute("delete from " + saved + " where name = ?", name);
+      const auto saved_count = objects_.size();
+
+      // Indexes of UNIQUE and PRIMARY KEY constraints have no SQL and are kept.
+      connection.execute([this, &tables](const Statement& s)
+      {
+        const auto table = s.result<std::string>(2);
+        if (tables.empty() ||
+          std::find(tables.begin(), tables.end(), table) != tables.end())
+          objects_.push_back({s.result<std::string>(0),
+            s.result<std::string>(1), s.result<std::string>(3)});
+      }, "select type, name, tbl_name, sql from sqlite_master"
+        " where type in ('index', 'trigger') and sql is not null"
+        " order by type, name");
+
+      auto insert = connection.prepare("insert into " + saved +
+        "(name, type, sql) values(?, ?, ?)");
+      for (auto i = saved_count; i < objects_.size(); ++i) {
+        const auto& object = objects_[i];
+        insert.execute(object.name, object.type, object.sql);
+        connection.execute("drop " + object.type + " " +
+          detail::quoted_identifier(object.name));
+      }
+      connection.execute("commit");
+    });
+    is_active_ = true;
+    connection.execute("pragma journal_mode = memory");
+    connection.execute("pragma synchronous = off");
+    load_start_ = Clock::now();
+    timings_.prepare = seconds__(start, load_start_);
+  }
+
+  /// Non copy-constructible.
+  Bulk_load_session(const Bulk_load_session&) = delete;
+
+  /// Non copy-assignable.
+  Bulk_load_session& operator=(const Bulk_load_session&) = delete;
+
+  /// Non move-constructible.
+  Bulk_load_session(Bulk_load_session&&) = delete;
+
+  /// Non move-assignable.
+  Bulk_load_session& operator=(Bulk_load_session&&) = delete;
+
+  /**
+   * @returns The inserter for the session.
+   *
+   * @see Bulk_inserter.
+   */
+  Bulk_inserter inserter(const std::string_view insert,
+    const std::size_t batch_size = Bulk_inserter::default_batch_size,
+    std::optional<Bulk_sort_options> sort = {}) const
+  {
+    return Bulk_inserter{*connection_, insert, batch_size, std::move(sort)};
+  }
+
+  /**
+   * @brief Recreates the indexes and triggers and restores the settings.
+   *
+   * @details Attempts to restore everything even if some step fails, and
+   * rethrows the first error. (E.g., the unique index cannot be recreated if
+   * the duplicates are loaded.) The DDL of the objects recreated is removed
+   * from the table `objects_table`, and the table is dropped if it's empty.
+   *
+   * @returns The timings.
+   *
+   * @par Requires
+   * `is_active() && !connection.is_transaction_active()`.
+   */
+  const Bulk_load_timings& finish()
+  {
+    if (!is_active_)
+      throw Exception{"cannot finish inactive bulk load session"};
+    else if (connection_->is_transaction_active())
+      throw Exception{"cannot finish bulk load session in transaction"};
+
+    is_active_ = false;
+    std::exception_ptr error;
+    const auto attempt = [&error](auto&& callback)
+    {
+      try {
+        callback();
+      } catch (...) {
+        if (!error)
+          error = std::current_exception();
+      }
+    };
+
+    const auto saved = detail::quoted_identifier(objects_table);
+    const auto recreate = [&](const Schema_object& object)
+    {
+      connection_->execute("begin");
+      connection_->with_rollback_on_error([&]
+      {
+        connection_->execute(object.sql);
+        connection_->execute("delete from " + saved + " where name = ?",
+          object.name);
+        connection_->execute("commit");
+      });
+    };
+
+    const auto index_start = Clock::now();
+    timings_.load = seconds__(load_start_, index_start);
+    for (const auto& object : objects_) {
+      if (object.type == "index")
+        attempt([&]{ recreate(object); });
+    }
+    const auto restore_start = Clock::now();
+    timings_.index = seconds__(index_start, restore_start);
+    for (const auto& object : objects_) {
+      if (object.type == "trigger")
+        attempt([&]{ recreate(object); });
+    }
+    attempt([&]
+    {
+      bool is_empty{true};
+      connection_->execute([&is_empty](const Statement&)
+      {
+        is_empty = false;
+      }, "select 1 from " + saved + " limit 1");
+      if (is_empty)
+        connection_->execute("drop table " + saved);
+    });
+    attempt([&]
+    {
+      connection_->execute("pragma journal_mode = " + journal_mode_);
+    });
+    attempt([&]
+    {
+      connection_->execute("pragma synchronous = " +
+        std::to_string(synchronous_));
+    });
+    timings_.restore = seconds__(restore_start, Clock::now());
+    if (error)
+      std::rethrow_exception(error);
+    return timings_;
+  }
+
+  /// @returns `true` if the session is not finished.
+  bool is_active() const noexcept
+  {
+    return is_active_;
+  }
+
+  /**
+   * @returns The indexes and triggers dropped for the session (including the
+   * ones left dropped by the sessions which are not finished).
+   */
+  const std::vector<Schema_object>& dropped_objects() const noexcept
+  {
+    return objects_;
+  }
+
+  /// @returns The timings of the phases finished.
+  const Bulk_load_timings& timings() const noexcept
+  {
+    return timings_;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Connection* connection_{};
+  bool is_active_{};
+  std::string journal_mode_;
+  int synchronous_{};
+  std::vector<Schema_object> objects_;
+  Clock::time_point load_start_;
+  Bulk_load_timings timings_;
+
+  static double seconds__(const Clock::time_point start,
+    const Clock::time_point end) noexcept
+  {
+    return std::chrono::duration<double>(end - start).count();
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_BULK_LOAD_HPP
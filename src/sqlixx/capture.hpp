@@ -0,0 +1,524 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_CAPTURE_HPP
+#define DMITIGR_SQLIXX_CAPTURE_HPP
+
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "../base/assert.hpp"
+#include "../fs/filesystem.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+namespace dmitigr::sqlixx {
+
+/// A captured event.
+enum class Capture_event : unsigned char {
+  /// A statement preparation.
+  prepare = 1,
+  /// A parameter binding.
+  bind = 2,
+  /// A call of `sqlite3_clear_bindings()`.
+  clear_bindings = 3,
+  /// A call of `sqlite3_step()`.
+  step = 4,
+  /// A call of `sqlite3_reset()`.
+  reset = 5,
+  /// A statement finalization.
+  finalize = 6
+};
+
+/// A type of captured value.
+enum class Capture_value_type : unsigned char {
+  /// NULL.
+  null = 0,
+  /// An integer.
+  integer = 1,
+  /// A floating point number.
+  real = 2,
+  /// An UTF-8 text.
+  text = 3,
+  /// A BLOB.
+  blob = 4,
+  /// A value of type that cannot be captured. (Replayed as NULL.)
+  unknown = 5
+};
+
+/// A captured record.
+struct Capture_record final {
+  /// The event.
+  Capture_event event{};
+
+  /// The number of nanoseconds since the capture was started.
+  std::uint64_t timestamp{};
+
+  /// The sequential number of the thread the event was emitted from.
+  std::uint64_t thread{};
+
+  /// The identifier of the statement which emitted the event.
+  std::uint64_t statement{};
+
+  /// The flags of Capture_event::prepare.
+  unsigned int flags{};
+
+  /// The one-based index of parameter of Capture_event::bind.
+  int index{};
+
+  /// The result of Capture_event::step.
+  int result{};
+
+  /// The value type of Capture_event::bind.
+  Capture_value_type value_type{};
+
+  /// The value of Capture_value_type::integer.
+  std::int64_t integer{};
+
+  /// The value of Capture_value_type::real.
+  double real{};
+
+  /// The SQL of Capture_event::prepare or the value of text or BLOB.
+  std::string bytes;
+};
+
+/**
+ * @brief A writer of the statement events into a compact binary file.
+ *
+ * @details The file starts with the 8-byte signature followed by records.
+ * Each record is an event byte followed by the unsigned LEB128-encoded
+ * timestamp, thread number and statement identifier, and the payload specific
+ * to the event.
+ *
+ * @remarks Thread-safe.
+ *
+ * @see Connection::set_capture(), Capture_reader.
+ */
+class Capture_writer final {
+public:
+  /// The signature of the capture file.
+  static constexpr char signature[8] = {'S','Q','L','I','X','X','C','1'};
+
+  /// The destructor.
+  ~Capture_writer()
+  {
+    if (file_)
+      std::fclose(file_);
+  }
+
+  /// The constructor. Truncates the file at `path` if it exists.
+  explicit Capture_writer(const std::filesystem::path& path)
+#ifdef _WIN32
+    : file_{_wfopen(path.c_str(), L"wb")}
+#else
+    : file_{std::fopen(path.c_str(), "wb")}
+#endif
+  {
+    if (!file_)
+      throw Exception{std::string{"cannot open SQLite capture file "}
+        .append(path.string())};
+
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    write(signature, sizeof(signature));
+  }
+
+  /// Non-copyable.
+  Capture_writer(const Capture_writer&) = delete;
+
+  /// Non-copyable.
+  Capture_writer& operator=(const Capture_writer&) = delete;
+
+  /// Non-movable.
+  Capture_writer(Capture_writer&&) = delete;
+
+  /// Non-movable.
+  Capture_writer& operator=(Capture_writer&&) = delete;
+
+  /// @returns The new unique statement identifier.
+  std::uint64_t make_statement_id() noexcept
+  {
+    const std::lock_guard lg{mutex_};
+    return ++last_statement_id_;
+  }
+
+  /// Writes the buffered records to the file.
+  void flush()
+  {
+    const std::lock_guard lg{mutex_};
+    if (std::fflush(file_))
+      throw Exception{"cannot flush SQLite capture file"};
+  }
+
+  /// Writes the record of Capture_event::prepare.
+  void prepare(const std::uint64_t statement, const std::string_view sql,
+    const unsigned int flags)
+  {
+    const std::lock_guard lg{mutex_};
+    write_header(Capture_event::prepare, statement);
+    write_varint(flags);
+    write_bytes(sql.data(), sql.size());
+  }
+
+  /// Writes the record of Capture_event::bind of NULL.
+  void bind_null(const std::uint64_t statement, const int index)
+  {
+    const std::lock_guard lg{mutex_};
+    write_bind_header(statement, index, Capture_value_type::null);
+  }
+
+  /// Writes the record of Capture_event::bind of value of unknown type.
+  void bind_unknown(const std::uint64_t statement, const int index)
+  {
+    const std::lock_guard lg{mutex_};
+    write_bind_header(statement, index, Capture_value_type::unknown);
+  }
+
+  /// Writes the record of Capture_event::bind of integer.
+  void bind_integer(const std::uint64_t statement, const int index,
+    const std::int64_t value)
+  {
+    const std::lock_guard lg{mutex_};
+    write_bind_header(statement, index, Capture_value_type::integer);
+    write_varint((static_cast<std::uint64_t>(value) << 1) ^
+      static_cast<std::uint64_t>(value >> 63));
+  }
+
+  /// Writes the record of Capture_event::bind of floating point number.
+  void bind_real(const std::uint64_t statement, const int index,
+    const double value)
+  {
+    const std::lock_guard lg{mutex_};
+    write_bind_header(statement, index, Capture_value_type::real);
+    write(&value, sizeof(value));
+  }
+
+  /// Writes the record of Capture_event::bind of text or BLOB.
+  void bind_bytes(const std::uint64_t statement, const int index,
+    const Capture_value_type type, const void* const data,
+    const std::uint64_t size)
+  {
+    DMITIGR_ASSERT(type == Capture_value_type::text ||
+      type == Capture_value_type::blob);
+    const std::lock_guard lg{mutex_};
+    write_bind_header(statement, index, type);
+    write_bytes(data, size);
+  }
+
+  /// Writes the record of Capture_event::clear_bindings.
+  void clear_bindings(const std::uint64_t statement)
+  {
+    const std::lock_guard lg{mutex_};
+    write_header(Capture_event::clear_bindings, statement);
+  }
+
+  /// Writes the record of Capture_event::step.
+  void step(const std::uint64_t statement, const int result)
+  {
+    const std::lock_guard lg{mutex_};
+    write_header(Capture_event::step, statement);
+    write_varint(static_cast<std::uint64_t>(result));
+  }
+
+  /// Writes the record of Capture_event::reset.
+  void reset(const std::uint64_t statement)
+  {
+    const std::lock_guard lg{mutex_};
+    write_header(Capture_event::reset, statement);
+  }
+
+  /// Writes the record of Capture_event::finalize.
+  void finalize(const std::uint64_t statement)
+  {
+    const std::lock_guard lg{mutex_};
+    write_header(Capture_event::finalize, statement);
+  }
+
+  /**
+   * @brief Writes the record of Capture_event::bind of `value`.
+   *
+   * @details Integral, floating point, UTF-8 text, BLOB values and
+   * `std::optional` of them are captured with their values. Values of other
+   * types are captured as Capture_value_type::unknown.
+   */
+  template<typename T>
+  void bind(const std::uint64_t statement, const int index, const T& value)
+  {
+    if constexpr (std::is_integral_v<T>) {
+      bind_integer(statement, index, static_cast<std::int64_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      bind_real(statement, index, static_cast<double>(value));
+    } else if constexpr (std::is_same_v<T, std::string> ||
+      std::is_same_v<T, std::string_view>) {
+      bind_bytes(statement, index, Capture_value_type::text,
+        value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, const char*> ||
+      std::is_same_v<T, char*>) {
+      if (value)
+        bind_bytes(statement, index, Capture_value_type::text,
+          value, std::strlen(value));
+      else
+        bind_null(statement, index);
+    } else if constexpr (std::is_same_v<T, Blob>) {
+      bind_bytes(statement, index, Capture_value_type::blob,
+        value.data(), value.size());
+    } else if constexpr (detail::Is_blob_sequence<T>::value) {
+      bind_bytes(statement, index, Capture_value_type::blob,
+        value.data(), value.size() * sizeof(*value.data()));
+    } else if constexpr (std::is_same_v<T, Text_utf8>) {
+      bind_bytes(statement, index, Capture_value_type::text,
+        value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, Value>) {
+      switch (value.type()) {
+      case SQLITE_INTEGER:
+        bind_integer(statement, index, value.to_int64());
+        break;
+      case SQLITE_FLOAT:
+        bind_real(statement, index, value.to_double());
+        break;
+      case SQLITE_TEXT: {
+        const auto text = value.to_text();
+        bind_bytes(statement, index, Capture_value_type::text,
+          text.data(), text.size());
+        break;
+      }
+      case SQLITE_BLOB: {
+        const auto blob = value.to_blob();
+        bind_bytes(statement, index, Capture_value_type::blob,
+          blob.data(), blob.size());
+        break;
+      }
+      default:
+        bind_null(statement, index);
+      }
+    } else if constexpr (Is_optional<T>::value) {
+      if (value)
+        bind(statement, index, *value);
+      else
+        bind_null(statement, index);
+    } else
+      bind_unknown(statement, index);
+  }
+
+private:
+  template<typename> struct Is_optional : std::false_type {};
+  template<typename T> struct Is_optional<std::optional<T>> : std::true_type {};
+
+  std::mutex mutex_;
+  std::FILE* file_{};
+  std::uint64_t last_statement_id_{};
+  std::chrono::steady_clock::time_point start_{std::chrono::steady_clock::now()};
+  std::unordered_map<std::thread::id, std::uint64_t> threads_;
+
+  void write(const void* const data, const std::size_t size)
+  {
+    if (std::fwrite(data, 1, size, file_) != size)
+      throw Exception{"cannot write SQLite capture file"};
+  }
+
+  void write_varint(std::uint64_t value)
+  {
+    unsigned char buf[10];
+    std::size_t size{};
+    do {
+      buf[size] = value & 0x7f;
+      value >>= 7;
+      if (value)
+        buf[size] |= 0x80;
+      ++size;
+    } while (value);
+    write(buf, size);
+  }
+
+  void write_bytes(const void* const data, const std::uint64_t size)
+  {
+    write_varint(size);
+    write(data, static_cast<std::size_t>(size));
+  }
+
+  void write_header(const Capture_event event, const std::uint64_t statement)
+  {
+    namespace chrono = std::chrono;
+    const auto [thread, inserted] = threads_.try_emplace(
+      std::this_thread::get_id(), threads_.size());
+    static_cast<void>(inserted);
+    const auto event_byte = static_cast<unsigned char>(event);
+    write(&event_byte, 1);
+    write_varint(static_cast<std::uint64_t>(chrono::duration_cast<
+        chrono::nanoseconds>(chrono::steady_clock::now() - start_).count()));
+    write_varint(thread->second);
+    write_varint(statement);
+  }
+
+  void write_bind_header(const std::uint64_t statement, const int index,
+    const Capture_value_type type)
+  {
+    write_header(Capture_event::bind, statement);
+    write_varint(static_cast<std::uint64_t>(index));
+    const auto type_byte = static_cast<unsigned char>(type);
+    write(&type_byte, 1);
+  }
+};
+
+/// A reader of the file written by Capture_writer.
+class Capture_reader final {
+public:
+  /// The destructor.
+  ~Capture_reader()
+  {
+    if (file_)
+      std::fclose(file_);
+  }
+
+  /// The constructor.
+  explicit Capture_reader(const std::filesystem::path& path)
+#ifdef _WIN32
+    : file_{_wfopen(path.c_str(), L"rb")}
+#else
+    : file_{std::fopen(path.c_str(), "rb")}
+#endif
+  {
+    if (!file_)
+      throw Exception{std::string{"cannot open SQLite capture file "}
+        .append(path.string())};
+
+    char sig[sizeof(Capture_writer::signature)];
+    if (std::fread(sig, 1, sizeof(sig), file_) != sizeof(sig) ||
+      std::memcmp(sig, Capture_writer::signature, sizeof(sig)))
+      throw Exception{std::string{"invalid SQLite capture file "}
+        .append(path.string())};
+  }
+
+  /// Non-copyable.
+  Capture_reader(const Capture_reader&) = delete;
+
+  /// Non-copyable.
+  Capture_reader& operator=(const Capture_reader&) = delete;
+
+  /// Non-movable.
+  Capture_reader(Capture_reader&&) = delete;
+
+  /// Non-movable.
+  Capture_reader& operator=(Capture_reader&&) = delete;
+
+  /**
+   * @brief Reads the next record into `record`.
+   *
+   * @returns `false` if there are no more records.
+   */
+  bool next(Capture_record& record)
+  {
+    const int event = std::fgetc(file_);
+    if (event == EOF)
+      return false;
+    else if (event < static_cast<int>(Capture_event::prepare) ||
+      event > static_cast<int>(Capture_event::finalize))
+      throw Exception{"invalid SQLite capture file record"};
+
+    record.event = static_cast<Capture_event>(event);
+    record.timestamp = read_varint();
+    record.thread = read_varint();
+    record.statement = read_varint();
+    switch (record.event) {
+    case Capture_event::prepare:
+      record.flags = static_cast<unsigned int>(read_varint());
+      read_bytes(record.bytes);
+      break;
+    case Capture_event::bind:
+      record.index = static_cast<int>(read_varint());
+      record.value_type = static_cast<Capture_value_type>(read_byte());
+      switch (record.value_type) {
+      case Capture_value_type::integer: {
+        const auto value = read_varint();
+        record.integer = static_cast<std::int64_t>(value >> 1) ^
+          -static_cast<std::int64_t>(value & 1);
+        break;
+      }
+      case Capture_value_type::real:
+        read(&record.real, sizeof(record.real));
+        break;
+      case Capture_value_type::text:
+        [[fallthrough]];
+      case Capture_value_type::blob:
+        read_bytes(record.bytes);
+        break;
+      case Capture_value_type::null:
+        [[fallthrough]];
+      case Capture_value_type::unknown:
+        break;
+      default:
+        throw Exception{"invalid SQLite capture file value type"};
+      }
+      break;
+    case Capture_event::step:
+      record.result = static_cast<int>(read_varint());
+      break;
+    case Capture_event::clear_bindings:
+      [[fallthrough]];
+    case Capture_event::reset:
+      [[fallthrough]];
+    case Capture_event::finalize:
+      break;
+    }
+    return true;
+  }
+
+private:
+  std::FILE* file_{};
+
+  void read(void* const data, const std::size_t size)
+  {
+    if (std::fread(data, 1, size, file_) != size)
+      throw Exception{"unexpected end of SQLite capture file"};
+  }
+
+  unsigned char read_byte()
+  {
+    unsigned char result;
+    read(&result, 1);
+    return result;
+  }
+
+  std::uint64_t read_varint()
+  {
+    std::uint64_t result{};
+    for (int shift = 0; shift < 64; shift += 7) {
+      const unsigned char byte = read_byte();
+      result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return result;
+    }
+    throw Exception{"invalid varint in SQLite capture file"};
+  }
+
+  void read_bytes(std::string& result)
+  {
+    result.resize(static_cast<std::size_t>(read_varint()));
+    read(result.data(), result.size());
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_CAPTURE_HPP
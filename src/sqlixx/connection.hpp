@@ -17,14 +17,18 @@
 #ifndef DMITIGR_SQLIXX_CONNECTION_HPP
 #define DMITIGR_SQLIXX_CONNECTION_HPP
 
+#include "connection_options.hpp"
 #include "statement.hpp"
+#include "statement_catalog.hpp"
 #include "../base/assert.hpp"
 #include "../fs/filesystem.hpp"
 
 #include <sqlite3.h>
 
 #include <cstdio>
+#include <cstddef>
 #include <exception>
+#include <memory>
 #include <new>
 #include <string>
 #include <string_view>
@@ -92,6 +96,46 @@ public:
 #endif
   {}
 
+  /**
+   * @brief The constructor.
+   *
+   * @details Opens the connection and applies the `options` to it.
+   *
+   * @see Connection(const char*, int).
+   */
+  template<typename R>
+  Connection(R&& ref, const int flags, const Connection_options& options)
+    : Connection{std::forward<R>(ref), flags}
+  {
+    if (const auto& lookaside = options.lookaside())
+      set_lookaside(*lookaside);
+    if (const auto timeout = options.busy_timeout()) {
+      if (const int r = sqlite3_busy_timeout(handle_,
+          static_cast<int>(timeout->count())); r != SQLITE_OK)
+        throw Sqlite_exception{r, "cannot set SQLite busy timeout"};
+    }
+
+    const auto pragma = [this](const char* const name, const auto& value)
+    {
+      if (value) {
+        std::string sql{"pragma "};
+        sql.append(name).append(" = ");
+        if constexpr (std::is_same_v<std::decay_t<decltype(*value)>, std::string>)
+          sql.append(*value);
+        else
+          sql.append(std::to_string(*value));
+        execute(sql);
+      }
+    };
+    // The page size must be set before the journal mode is switched to WAL.
+    pragma("page_size", options.page_size());
+    pragma("journal_mode", options.journal_mode());
+    pragma("synchronous", options.synchronous());
+    pragma("cache_size", options.cache_size());
+    pragma("mmap_size", options.mmap_size());
+    pragma("wal_autocheckpoint", options.wal_autocheckpoint());
+  }
+
   /// Non-copyable.
   Connection(const Connection&) = delete;
 
@@ -101,6 +145,9 @@ public:
   /// The move constructor.
   Connection(Connection&& rhs) noexcept
     : handle_{rhs.handle_}
+    , catalog_{std::move(rhs.catalog_)}
+    , catalog_statements_{std::move(rhs.catalog_statements_)}
+    , capture_{std::move(rhs.capture_)}
   {
     rhs.handle_ = {};
   }
@@ -120,6 +167,9 @@ public:
   {
     using std::swap;
     swap(handle_, other.handle_);
+    swap(catalog_, other.catalog_);
+    swap(catalog_statements_, other.catalog_statements_);
+    swap(capture_, other.capture_);
   }
 
   /// @returns The guarded handle.
@@ -134,9 +184,14 @@ public:
     return handle_;
   }
 
-  /// @returns The released handle.
+  /**
+   * @returns The released handle.
+   *
+   * @details Finalizes the statements prepared by using the statement catalog.
+   */
   sqlite3* release() noexcept
   {
+    catalog_statements_.reset();
     auto* const result = handle_;
     handle_ = {};
     return result;
@@ -145,12 +200,66 @@ public:
   /// Closes the database connection.
   void close()
   {
+    catalog_statements_.reset();
     if (const int r = sqlite3_close(handle_); r != SQLITE_OK)
       throw Sqlite_exception{r, sqlite3_errmsg(handle_)};
     else
       handle_ = {};
   }
 
+  /**
+   * @brief Configures the lookaside memory allocator of this connection.
+   *
+   * @par Requires
+   * `handle()`.
+   *
+   * @remarks The lookaside memory cannot be reconfigured while any of it is
+   * in use. Thus, it's best to call this function right after opening.
+   *
+   * @see Connection_options::set_lookaside().
+   */
+  void set_lookaside(const Lookaside_config& config)
+  {
+    if (!handle_)
+      throw Exception{"cannot configure lookaside memory of invalid SQLite "
+        "connection"};
+
+    if (const int r = sqlite3_db_config(handle_, SQLITE_DBCONFIG_LOOKASIDE,
+        config.buffer, config.slot_size, config.slot_count); r != SQLITE_OK)
+      throw Sqlite_exception{r, std::string{"cannot configure SQLite lookaside "
+        "memory"}.append(" (").append(sqlite3_errstr(r)).append(")")};
+  }
+
+  /**
+   * @returns The status of the lookaside memory allocator.
+   *
+   * @param reset Whether to reset the highwater mark and the counters of
+   * hits and misses?
+   *
+   * @par Requires
+   * `handle()`.
+   */
+  Lookaside_status lookaside_status(const bool reset = false) const
+  {
+    if (!handle_)
+      throw Exception{"cannot get lookaside memory status of invalid SQLite "
+        "connection"};
+
+    Lookaside_status result;
+    int unused{};
+    const auto status = [this, reset](const int op, int& cur, int& hiwtr)
+    {
+      if (const int r = sqlite3_db_status(handle_, op, &cur, &hiwtr, reset);
+        r != SQLITE_OK)
+        throw Sqlite_exception{r, "cannot get SQLite lookaside memory status"};
+    };
+    status(SQLITE_DBSTATUS_LOOKASIDE_USED, result.used, result.used_highwater);
+    status(SQLITE_DBSTATUS_LOOKASIDE_HIT, unused, result.hit);
+    status(SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, unused, result.miss_size);
+    status(SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, unused, result.miss_full);
+    return result;
+  }
+
   /**
    * @returns An instance of type Statement.
    *
@@ -158,7 +267,90 @@ public:
    */
   Statement prepare(const std::string_view sql, const unsigned int flags = 0)
   {
-    return Statement{handle_, sql, flags};
+    Statement result{handle_, sql, flags};
+    if (capture_) {
+      result.capture_ = capture_;
+      result.capture_id_ = capture_->make_statement_id();
+      capture_->prepare(result.capture_id_, sql, flags);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Sets the capture writer.
+   *
+   * @details If `capture` is not null, then each statement prepared by this
+   * instance afterwards writes the records of its preparation, bindings,
+   * steps, resets and finalization into `capture`. Statements prepared before
+   * the call are not affected. Passing the null pointer stops the capture for
+   * statements prepared afterwards.
+   *
+   * @remarks The same writer can be shared between several connections.
+   *
+   * @see Capture_writer.
+   */
+  void set_capture(std::shared_ptr<Capture_writer> capture) noexcept
+  {
+    capture_ = std::move(capture);
+  }
+
+  /// @returns The capture writer.
+  const std::shared_ptr<Capture_writer>& capture() const noexcept
+  {
+    return capture_;
+  }
+
+  /**
+   * @brief Sets the statement catalog.
+   *
+   * @details Finalizes all the statements prepared by using the catalog set
+   * previously (if any).
+   *
+   * @see statement().
+   */
+  void set_statement_catalog(std::shared_ptr<const Statement_catalog> catalog)
+  {
+    catalog_statements_.reset(catalog ?
+      new Statement[catalog->size()] : nullptr);
+    catalog_ = std::move(catalog);
+  }
+
+  /// @returns The statement catalog.
+  const std::shared_ptr<const Statement_catalog>& statement_catalog() const noexcept
+  {
+    return catalog_;
+  }
+
+  /**
+   * @returns The statement of the statement catalog by the `id`. The
+   * statement is prepared at the first call and cached by this instance.
+   *
+   * @par Requires
+   * `handle() && statement_catalog() && id < statement_catalog()->size()`.
+   */
+  Statement& statement(const std::size_t id)
+  {
+    if (!handle_)
+      throw Exception{"cannot get SQLite statement from catalog of invalid "
+        "SQLite connection"};
+    else if (!catalog_)
+      throw Exception{"cannot get SQLite statement from catalog: no catalog "
+        "set"};
+    else if (!(id < catalog_->size()))
+      throw Exception{"cannot get SQLite statement from catalog using invalid "
+        "identifier"};
+
+    if (!catalog_statements_)
+      catalog_statements_.reset(new Statement[catalog_->size()]);
+    auto& result = catalog_statements_[id];
+    if (!result) {
+      const auto& entry = catalog_->entries_[id];
+      result = prepare(entry.sql, entry.flags);
+      catalog_->count_prepare(id);
+    } else if (const int r = result.last_step_result();
+      r >= 0 && r != SQLITE_ROW && r != SQLITE_DONE)
+      result.reset(); // otherwise the failed execution would be repeated
+    return result;
   }
 
   /**
@@ -186,6 +378,48 @@ public:
     execute([](const auto&){ return true; }, sql, std::forward<Types>(values)...);
   }
 
+  /**
+   * @brief Executes the `sql` which may consist of several statements
+   * separated by semicolons.
+   *
+   * @details The statements are prepared and executed one by one, so each
+   * one can depend on the effects of the previous ones (e.g. refer to a table
+   * created before). The results of the statements are discarded.
+   *
+   * @par Requires
+   * `handle()`.
+   */
+  void execute_script(const std::string_view sql)
+  {
+    if (!handle_)
+      throw Exception{"cannot execute SQLite script using invalid connection"};
+
+    const char* tail = sql.data();
+    const char* const end = sql.data() + sql.size();
+    while (tail != end) {
+      const char* const head = tail;
+      sqlite3_stmt* handle{};
+      if (const int r = sqlite3_prepare_v3(handle_, head,
+          static_cast<int>(end - head), 0, &handle, &tail); r != SQLITE_OK)
+        throw Sqlite_exception{r, std::string{"cannot prepare SQLite statement "
+          "of script ("}.append(sqlite3_errmsg(handle_)).append(")")};
+      else if (!handle) { // empty statement, whitespaces or comments
+        if (tail == head)
+          break;
+        continue;
+      }
+
+      Statement statement{handle};
+      if (capture_) {
+        statement.capture_ = capture_;
+        statement.capture_id_ = capture_->make_statement_id();
+        capture_->prepare(statement.capture_id_,
+          std::string_view{head, static_cast<std::size_t>(tail - head)}, 0);
+      }
+      statement.execute();
+    }
+  }
+
   /**
    * @returns `true` if this connection is not in autocommit mode. Autocommit
    * mode is disabled by a `BEGIN` command and re-enabled by a `COMMIT` or
@@ -233,6 +467,9 @@ public:
 
 private:
   sqlite3* handle_{};
+  std::shared_ptr<const Statement_catalog> catalog_;
+  std::unique_ptr<Statement[]> catalog_statements_;
+  std::shared_ptr<Capture_writer> capture_;
 };
 
 } // namespace dmitigr::sqlixx
@@ -0,0 +1,207 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_CONNECTION_FACTORY_HPP
+#define DMITIGR_SQLIXX_CONNECTION_FACTORY_HPP
+
+#include "connection.hpp"
+#include "connection_options.hpp"
+#include "exceptions.hpp"
+#include "statement_catalog.hpp"
+
+#include <sqlite3.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/**
+ * @brief A factory of warm connections.
+ *
+ * @details The factory keeps up to `capacity` connections warmed up in the
+ * background thread. The warm-up of a new connection consists of:
+ *   -# opening the connection with the options (which applies the pragmas);
+ *   -# touching the schema to make SQLite to parse it;
+ *   -# preparing all the statements of the statement catalog (if any);
+ *   -# executing the priming queries (if any) to populate the page cache.
+ *
+ * @par Thread safety
+ * `get()` can be called by several threads concurrently.
+ */
+class Connection_factory final {
+public:
+  /// The destructor. Stops the background thread.
+  ~Connection_factory()
+  {
+    {
+      const std::lock_guard lg{mutex_};
+      is_stopping_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+
+  /**
+   * @brief The constructor. Launches the background thread.
+   *
+   * @param ref The reference to the database (a path or URI).
+   * @param flags The flags to open connections with.
+   * @param options The options to apply to connections.
+   * @param catalog The statement catalog to set to connections.
+   * @param priming_queries The queries to execute on connections to prime the
+   * page cache. The rows returned by these queries are ignored.
+   * @param capacity The maximum number of warm connections to keep.
+   *
+   * @par Requires
+   * `capacity > 0`.
+   */
+  explicit Connection_factory(std::string ref,
+    const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+    Connection_options options = {},
+    std::shared_ptr<const Statement_catalog> catalog = {},
+    std::vector<std::string> priming_queries = {},
+    const std::size_t capacity = 1)
+    : ref_{std::move(ref)}
+    , flags_{flags}
+    , options_{std::move(options)}
+    , catalog_{std::move(catalog)}
+    , priming_queries_{std::move(priming_queries)}
+    , capacity_{capacity}
+  {
+    if (!capacity_)
+      throw Exception{"cannot create SQLite connection factory of zero capacity"};
+    worker_ = std::thread{&Connection_factory::run, this};
+  }
+
+  /// Non copy-constructible.
+  Connection_factory(const Connection_factory&) = delete;
+
+  /// Non copy-assignable.
+  Connection_factory& operator=(const Connection_factory&) = delete;
+
+  /// Non move-constructible.
+  Connection_factory(Connection_factory&&) = delete;
+
+  /// Non move-assignable.
+  Connection_factory& operator=(Connection_factory&&) = delete;
+
+  /**
+   * @returns The warm connection. Waits until it's available.
+   *
+   * @throws The exception thrown upon the warm-up of the connection. (The
+   * next warm-up is started only after the exception is thrown.)
+   */
+  Connection get()
+  {
+    std::unique_lock lk{mutex_};
+    cv_.wait(lk, [this]{ return !ready_.empty() || error_; });
+    if (error_) {
+      const auto error = std::move(error_);
+      error_ = {};
+      lk.unlock();
+      cv_.notify_all();
+      std::rethrow_exception(error);
+    }
+    auto result = std::move(ready_.front());
+    ready_.pop_front();
+    lk.unlock();
+    cv_.notify_all();
+    return result;
+  }
+
+  /// @returns The maximum number of warm connections.
+  std::size_t capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  /// @returns The number of warm connections available.
+  std::size_t ready_count() const
+  {
+    const std::lock_guard lg{mutex_};
+    return ready_.size();
+  }
+
+private:
+  std::string ref_;
+  int flags_{};
+  Connection_options options_;
+  std::shared_ptr<const Statement_catalog> catalog_;
+  std::vector<std::string> priming_queries_;
+  std::size_t capacity_{};
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Connection> ready_;
+  std::exception_ptr error_;
+  bool is_stopping_{};
+  std::thread worker_;
+
+  /// @returns A new warm connection. Called in the background thread.
+  Connection make_warm_connection() const
+  {
+    Connection result{ref_, flags_, options_};
+    result.execute("select count(*) from sqlite_master");
+    if (catalog_) {
+      result.set_statement_catalog(catalog_);
+      for (std::size_t i = 0; i < catalog_->size(); ++i)
+        result.statement(i);
+    }
+    for (const auto& query : priming_queries_)
+      result.execute(query);
+    return result;
+  }
+
+  void run()
+  {
+    while (true) {
+      {
+        std::unique_lock lk{mutex_};
+        cv_.wait(lk, [this]
+        {
+          return is_stopping_ || (!error_ && ready_.size() < capacity_);
+        });
+        if (is_stopping_)
+          return;
+      }
+
+      try {
+        auto conn = make_warm_connection();
+        {
+          const std::lock_guard lg{mutex_};
+          ready_.push_back(std::move(conn));
+        }
+      } catch (...) {
+        const std::lock_guard lg{mutex_};
+        error_ = std::current_exception();
+      }
+      cv_.notify_all();
+    }
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_CONNECTION_FACTORY_HPP
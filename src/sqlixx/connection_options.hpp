@@ -0,0 +1,212 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_CONNECTION_OPTIONS_HPP
+#define DMITIGR_SQLIXX_CONNECTION_OPTIONS_HPP
+
+#include <sqlite3.h>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace dmitigr::sqlixx {
+
+/**
+ * @brief A lookaside memory allocator configuration.
+ *
+ * @see https://www.sqlite.org/malloc.html#lookaside
+ */
+struct Lookaside_config final {
+  /// The size of each slot in bytes. (Should be a multiple of 8.)
+  int slot_size{};
+
+  /// The number of slots.
+  int slot_count{};
+
+  /**
+   * The caller-provided memory of at least `slot_size * slot_count` bytes,
+   * or `nullptr` to let SQLite to allocate the memory by itself. The memory
+   * must outlive the connection.
+   */
+  void* buffer{};
+};
+
+/// A lookaside memory allocator status.
+struct Lookaside_status final {
+  /// The number of slots currently checked out.
+  int used{};
+
+  /// The highest number of slots ever checked out.
+  int used_highwater{};
+
+  /// The number of allocations satisfied from the lookaside memory.
+  int hit{};
+
+  /// The number of allocations failed because the slot was too small.
+  int miss_size{};
+
+  /// The number of allocations failed because all slots were in use.
+  int miss_full{};
+};
+
+/// Connection options.
+class Connection_options final {
+public:
+  /**
+   * @brief Sets the lookaside memory allocator configuration.
+   *
+   * @remarks The configuration is applied immediately after the connection
+   * is opened, before any lookaside memory is checked out.
+   */
+  Connection_options& set_lookaside(const std::optional<Lookaside_config> value)
+  {
+    lookaside_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  const std::optional<Lookaside_config>& lookaside() const noexcept
+  {
+    return lookaside_;
+  }
+
+  /**
+   * @brief Sets the page size of the database (`PRAGMA page_size`).
+   *
+   * @remarks Has effect only for a new database or after `VACUUM`.
+   */
+  Connection_options& set_page_size(const std::optional<int> value)
+  {
+    page_size_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  std::optional<int> page_size() const noexcept
+  {
+    return page_size_;
+  }
+
+  /**
+   * @brief Sets the suggested maximum number of database pages kept in memory
+   * (`PRAGMA cache_size`). Negative values specify the size in KiB.
+   */
+  Connection_options& set_cache_size(const std::optional<int> value)
+  {
+    cache_size_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  std::optional<int> cache_size() const noexcept
+  {
+    return cache_size_;
+  }
+
+  /**
+   * @brief Sets the maximum number of bytes of the database file to be
+   * accessed using memory-mapped I/O (`PRAGMA mmap_size`).
+   */
+  Connection_options& set_mmap_size(const std::optional<sqlite3_int64> value)
+  {
+    mmap_size_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  std::optional<sqlite3_int64> mmap_size() const noexcept
+  {
+    return mmap_size_;
+  }
+
+  /**
+   * @brief Sets the journal mode (`PRAGMA journal_mode`), for example,
+   * `"wal"`.
+   */
+  Connection_options& set_journal_mode(std::optional<std::string> value)
+  {
+    journal_mode_ = std::move(value);
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  const std::optional<std::string>& journal_mode() const noexcept
+  {
+    return journal_mode_;
+  }
+
+  /**
+   * @brief Sets the synchronous mode (`PRAGMA synchronous`), for example,
+   * `"normal"`.
+   */
+  Connection_options& set_synchronous(std::optional<std::string> value)
+  {
+    synchronous_ = std::move(value);
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  const std::optional<std::string>& synchronous() const noexcept
+  {
+    return synchronous_;
+  }
+
+  /**
+   * @brief Sets the WAL auto-checkpoint interval in pages
+   * (`PRAGMA wal_autocheckpoint`).
+   */
+  Connection_options& set_wal_autocheckpoint(const std::optional<int> value)
+  {
+    wal_autocheckpoint_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  std::optional<int> wal_autocheckpoint() const noexcept
+  {
+    return wal_autocheckpoint_;
+  }
+
+  /// Sets the busy timeout (`sqlite3_busy_timeout()`).
+  Connection_options&
+  set_busy_timeout(const std::optional<std::chrono::milliseconds> value)
+  {
+    busy_timeout_ = value;
+    return *this;
+  }
+
+  /// @returns The current value of the option.
+  std::optional<std::chrono::milliseconds> busy_timeout() const noexcept
+  {
+    return busy_timeout_;
+  }
+
+private:
+  std::optional<Lookaside_config> lookaside_;
+  std::optional<int> page_size_;
+  std::optional<int> cache_size_;
+  std::optional<sqlite3_int64> mmap_size_;
+  std::optional<std::string> journal_mode_;
+  std::optional<std::string> synchronous_;
+  std::optional<int> wal_autocheckpoint_;
+  std::optional<std::chrono::milliseconds> busy_timeout_;
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_CONNECTION_OPTIONS_HPP
@@ -23,11 +23,15 @@
 
 #include <sqlite3.h>
 
+#include <array>
+#include <cstddef>
+#include <cstring>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace dmitigr::sqlixx {
 
@@ -174,6 +178,144 @@ struct Conversions<T,
   }
 };
 
+namespace detail {
+template<typename S>
+void bind_blob_sequence(sqlite3_stmt* const handle, const int index,
+  const S& value, const sqlite3_destructor_type destr)
+{
+  const sqlite3_uint64 size = value.size() * sizeof(*value.data());
+  detail::check_bind(handle, size ?
+    sqlite3_bind_blob64(handle, index, value.data(), size, destr) :
+    sqlite3_bind_zeroblob(handle, index, 0));
+}
+
+inline std::size_t blob_sequence_size(sqlite3_stmt* const handle,
+  const int index, const std::size_t value_size)
+{
+  DMITIGR_ASSERT(handle);
+  const auto result = static_cast<std::size_t>(sqlite3_column_bytes(handle, index));
+  if (result % value_size)
+    throw Exception{"cannot convert a blob of " + std::to_string(result) +
+      " bytes to a sequence of values of " + std::to_string(value_size) +
+      " bytes"};
+  return result;
+}
+} // namespace detail
+
+/**
+ * @brief The implementation of `Span<T>` conversions.
+ *
+ * @details The result is a view of the blob unless the blob is not suitably
+ * aligned for `T`, so it's valid until the next step or reset of the statement
+ * just like `Blob`.
+ */
+template<typename T>
+struct Conversions<Span<T>> final {
+  template<typename S>
+  static std::enable_if_t<std::is_same_v<std::decay_t<S>, Span<T>>>
+  bind(sqlite3_stmt* const handle, const int index, S&& value)
+  {
+    const auto destr = std::is_rvalue_reference_v<S&&> && value.is_data_owner() ?
+      SQLITE_TRANSIENT : SQLITE_STATIC;
+    detail::bind_blob_sequence(handle, index, value, destr);
+  }
+
+  static Span<T> result(sqlite3_stmt* const handle, const int index)
+  {
+    const auto size = detail::blob_sequence_size(handle, index, sizeof(T));
+    return Span<T>::from_blob(sqlite3_column_blob(handle, index), size);
+  }
+};
+
+/// The implementation of `std::vector<T>` conversions for trivially copyable `T`.
+template<typename T>
+struct Conversions<std::vector<T>,
+  std::enable_if_t<detail::Is_blob_value<T>>> final {
+  template<typename V>
+  static std::enable_if_t<std::is_same_v<std::decay_t<V>, std::vector<T>>>
+  bind(sqlite3_stmt* const handle, const int index, V&& value)
+  {
+    const auto destr = std::is_rvalue_reference_v<V&&> ?
+      SQLITE_TRANSIENT : SQLITE_STATIC;
+    detail::bind_blob_sequence(handle, index, value, destr);
+  }
+
+  static std::vector<T> result(sqlite3_stmt* const handle, const int index)
+  {
+    const auto size = detail::blob_sequence_size(handle, index, sizeof(T));
+    std::vector<T> result(size / sizeof(T));
+    if (size)
+      std::memcpy(result.data(), sqlite3_column_blob(handle, index), size);
+    return result;
+  }
+};
+
+/// The implementation of `std::array<T, N>` conversions for trivially copyable `T`.
+template<typename T, std::size_t N>
+struct Conversions<std::array<T, N>,
+  std::enable_if_t<detail::Is_blob_value<T>>> final {
+  template<typename A>
+  static std::enable_if_t<std::is_same_v<std::decay_t<A>, std::array<T, N>>>
+  bind(sqlite3_stmt* const handle, const int index, A&& value)
+  {
+    const auto destr = std::is_rvalue_reference_v<A&&> ?
+      SQLITE_TRANSIENT : SQLITE_STATIC;
+    detail::bind_blob_sequence(handle, index, value, destr);
+  }
+
+  static std::array<T, N> result(sqlite3_stmt* const handle, const int index)
+  {
+    const auto size = detail::blob_sequence_size(handle, index, sizeof(T));
+    if (size != sizeof(T) * N)
+      throw Exception{"cannot convert a blob of " + std::to_string(size) +
+        " bytes to an array of " + std::to_string(sizeof(T) * N) + " bytes"};
+    std::array<T, N> result;
+    if (size)
+      std::memcpy(result.data(), sqlite3_column_blob(handle, index), size);
+    return result;
+  }
+};
+
+/**
+ * @brief The implementation of `Pointer<T>` conversions.
+ *
+ * @details The result is only available for the columns which are the
+ * parameters bound by pointers, e.g. of statement `select ?`.
+ */
+template<typename T>
+struct Conversions<Pointer<T>> final {
+  static void bind(sqlite3_stmt* const handle, const int index,
+    const Pointer<T> value)
+  {
+    detail::check_bind(handle, sqlite3_bind_pointer(handle, index,
+      const_cast<std::remove_cv_t<T>*>(value.value), pointer_type<T>(), nullptr));
+  }
+
+  static Pointer<T> result(sqlite3_stmt* const handle, const int index)
+  {
+    DMITIGR_ASSERT(handle);
+    return {value_pointer<T>(sqlite3_column_value(handle, index))};
+  }
+};
+
+/// The implementation of `Value` conversions.
+template<>
+struct Conversions<Value> final {
+  static void bind(sqlite3_stmt* const handle, const int index,
+    const Value& value)
+  {
+    detail::check_bind(handle, value.handle() ?
+      sqlite3_bind_value(handle, index, value.handle()) :
+      sqlite3_bind_null(handle, index));
+  }
+
+  static Value result(sqlite3_stmt* const handle, const int index)
+  {
+    DMITIGR_ASSERT(handle);
+    return Value{sqlite3_column_value(handle, index)};
+  }
+};
+
 /// The implementation of `std::optional<T>` conversions.
 template<typename T>
 struct Conversions<std::optional<T>> final {
@@ -183,9 +325,9 @@ struct Conversions<std::optional<T>> final {
   {
     if (value) {
       if constexpr (std::is_rvalue_reference_v<O&&>) {
-        bind(handle, index, std::move(*value));
+        Conversions<T>::bind(handle, index, std::move(*value));
       } else
-        bind(handle, index, *value);
+        Conversions<T>::bind(handle, index, *value);
     } else
       detail::check_bind(handle, sqlite3_bind_null(handle, index));
   }
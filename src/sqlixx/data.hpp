@@ -21,7 +21,16 @@
 
 #include <sqlite3.h>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
 #include <utility>
+#include <vector>
 
 namespace dmitigr::sqlixx {
 
@@ -149,6 +158,342 @@ using Text_utf16le = Data<char, SQLITE_UTF16LE>;
 /// An alias of UTF16BE text type.
 using Text_utf16be = Data<char, SQLITE_UTF16BE>;
 
+/**
+ * @brief A contiguous sequence of values of trivially copyable type `T` which
+ * is bound and retrieved as a blob.
+ *
+ * @details Usually, the instance is a non-owning view. But the result of type
+ * Span retrieved from a blob which is not suitably aligned for `T` owns the
+ * aligned copy of the data.
+ */
+template<typename T>
+class Span final {
+  static_assert(std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool>,
+    "T must be trivially copyable");
+public:
+  /// The value type.
+  using Type = T;
+
+  /// The default constructor.
+  Span() = default;
+
+  /// The constructor.
+  Span(const T* const data, const std::size_t size) noexcept
+    : data_{data}
+    , size_{size}
+  {}
+
+  /// @overload
+  template<typename C, typename = std::enable_if_t<
+    std::is_convertible_v<decltype(std::declval<const C&>().data()), const T*> &&
+    std::is_convertible_v<decltype(std::declval<const C&>().size()), std::size_t>>>
+  Span(const C& container) noexcept
+    : Span{container.data(), container.size()}
+  {}
+
+  /**
+   * @returns The span of values of the blob `data` of `size` bytes. If `data`
+   * is not suitably aligned for `T` the result owns the aligned copy of data.
+   *
+   * @par Requires
+   * `!(size % sizeof(T))`.
+   */
+  static Span from_blob(const void* const data, const std::size_t size)
+  {
+    DMITIGR_ASSERT(!(size % sizeof(T)));
+    const std::size_t count{size / sizeof(T)};
+    if (!count)
+      return Span{};
+    else if (!(reinterpret_cast<std::uintptr_t>(data) % alignof(T)))
+      return Span{static_cast<const T*>(data), count};
+
+    Span result;
+    result.copy_.reset(new T[count]);
+    std::memcpy(result.copy_.get(), data, size);
+    result.data_ = result.copy_.get();
+    result.size_ = count;
+    return result;
+  }
+
+  /// Non-copyable.
+  Span(const Span&) = delete;
+
+  /// Non-copyable.
+  Span& operator=(const Span&) = delete;
+
+  /// Movable.
+  Span(Span&&) noexcept = default;
+
+  /// Movable.
+  Span& operator=(Span&&) noexcept = default;
+
+  /// @returns The data.
+  const T* data() const noexcept { return data_; }
+
+  /// @returns The number of values.
+  std::size_t size() const noexcept { return size_; }
+
+  /// @returns The size in bytes.
+  std::size_t size_bytes() const noexcept { return size_ * sizeof(T); }
+
+  /// @returns `true` if this instance is empty.
+  bool empty() const noexcept { return !size_; }
+
+  /// @returns `true` if this instance owns the data.
+  bool is_data_owner() const noexcept { return static_cast<bool>(copy_); }
+
+  /// @returns The value at the specified `index`.
+  const T& operator[](const std::size_t index) const noexcept
+  {
+    return data_[index];
+  }
+
+  /// @returns The iterator to the first value.
+  const T* begin() const noexcept { return data_; }
+
+  /// @returns The iterator past the last value.
+  const T* end() const noexcept { return data_ + size_; }
+
+private:
+  const T* data_{};
+  std::size_t size_{};
+  std::unique_ptr<T[]> copy_;
+};
+
+/**
+ * @brief A non-owning pointer to the in-process object of type `T` to be
+ * passed to the application-defined SQL functions and virtual tables.
+ *
+ * @details The pointer is bound by using `sqlite3_bind_pointer()` with the
+ * type tag returned by `pointer_type<T>()`, so it's invisible to SQL and can
+ * only be extracted by the code which knows `T`.
+ *
+ * @see pointer_type(), value_pointer().
+ */
+template<typename T>
+struct Pointer final {
+  /// The value type.
+  using Type = T;
+
+  /// The pointer.
+  T* value{};
+};
+
+/**
+ * @returns The type tag of pointers to objects of type `T`. The tags of
+ * pointers to `T` and to `const T` are different.
+ *
+ * @remarks The result is a static string as `sqlite3_bind_pointer()` requires.
+ */
+template<typename T>
+const char* pointer_type() noexcept
+{
+  return typeid(T*).name();
+}
+
+/**
+ * @returns The pointer to the object of type `T` bound by using `Pointer<T>`
+ * (or by using `Pointer<std::remove_const_t<T>>` if `T` is const-qualified),
+ * or `nullptr` if `value` is not such a pointer. Thus, the object bound as
+ * const can only be extracted as const.
+ */
+template<typename T>
+T* value_pointer(sqlite3_value* const value) noexcept
+{
+  auto* const result = static_cast<T*>(
+    sqlite3_value_pointer(value, pointer_type<T>()));
+  if constexpr (std::is_const_v<T>) {
+    if (!result)
+      return value_pointer<std::remove_const_t<T>>(value);
+  }
+  return result;
+}
+
+/**
+ * @brief A dynamically typed value.
+ *
+ * @details The instance owns the protected copy of `sqlite3_value` made by
+ * `sqlite3_value_dup()`, so it outlives the statement row or the function
+ * argument it's created from, and can be bound to another statement as is,
+ * without the conversion. The default constructed instance represents NULL.
+ */
+class Value final {
+public:
+  /// The destructor.
+  ~Value()
+  {
+    sqlite3_value_free(handle_);
+  }
+
+  /// The default constructor.
+  Value() = default;
+
+  /**
+   * @brief Makes a copy of the `value`.
+   *
+   * @par Requires
+   * `value`.
+   */
+  explicit Value(const sqlite3_value* const value)
+    : handle_{sqlite3_value_dup(value)}
+  {
+    DMITIGR_ASSERT(value);
+    if (!handle_)
+      throw std::bad_alloc{};
+  }
+
+  /// The copy constructor.
+  Value(const Value& rhs)
+    : handle_{rhs.handle_ ? sqlite3_value_dup(rhs.handle_) : nullptr}
+  {
+    if (rhs.handle_ && !handle_)
+      throw std::bad_alloc{};
+  }
+
+  /// The copy assignment operator.
+  Value& operator=(const Value& rhs)
+  {
+    if (this != &rhs) {
+      Value tmp{rhs};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The move constructor.
+  Value(Value&& rhs) noexcept
+    : handle_{rhs.handle_}
+  {
+    rhs.handle_ = {};
+  }
+
+  /// The move assignment operator.
+  Value& operator=(Value&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      Value tmp{std::move(rhs)};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The swap operation.
+  void swap(Value& other) noexcept
+  {
+    using std::swap;
+    swap(handle_, other.handle_);
+  }
+
+  /// @returns The underlying handle, or `nullptr` if default constructed.
+  sqlite3_value* handle() const noexcept
+  {
+    return handle_;
+  }
+
+  /**
+   * @returns The fundamental type of the value (`SQLITE_INTEGER`,
+   * `SQLITE_FLOAT`, `SQLITE_TEXT`, `SQLITE_BLOB` or `SQLITE_NULL`).
+   */
+  int type() const noexcept
+  {
+    return handle_ ? sqlite3_value_type(handle_) : SQLITE_NULL;
+  }
+
+  /// @returns `type() == SQLITE_NULL`.
+  bool is_null() const noexcept
+  {
+    return type() == SQLITE_NULL;
+  }
+
+  /// @returns The value converted to integer by the SQLite rules.
+  int to_int() const noexcept
+  {
+    return handle_ ? sqlite3_value_int(handle_) : 0;
+  }
+
+  /// @returns The value converted to 64-bit integer by the SQLite rules.
+  sqlite3_int64 to_int64() const noexcept
+  {
+    return handle_ ? sqlite3_value_int64(handle_) : 0;
+  }
+
+  /// @returns The value converted to real by the SQLite rules.
+  double to_double() const noexcept
+  {
+    return handle_ ? sqlite3_value_double(handle_) : 0;
+  }
+
+  /**
+   * @returns The value converted to UTF-8 text by the SQLite rules.
+   *
+   * @remarks The result is valid until the value is modified or destroyed.
+   * Since the conversion is made in place, the result of `to_blob()` called
+   * before is invalidated.
+   */
+  Text_utf8 to_text() const
+  {
+    if (!handle_)
+      return {};
+    const auto* const data = sqlite3_value_text(handle_);
+    if (!data && sqlite3_value_type(handle_) != SQLITE_NULL)
+      throw std::bad_alloc{};
+    return {reinterpret_cast<const char*>(data),
+      static_cast<Text_utf8::Size>(sqlite3_value_bytes(handle_))};
+  }
+
+  /**
+   * @returns The value converted to blob by the SQLite rules.
+   *
+   * @remarks The result is valid until the value is modified or destroyed.
+   */
+  Blob to_blob() const
+  {
+    if (!handle_)
+      return {};
+    const void* const data = sqlite3_value_blob(handle_);
+    const auto size = sqlite3_value_bytes(handle_);
+    if (!data && size)
+      throw std::bad_alloc{};
+    return {data, static_cast<Blob::Size>(size)};
+  }
+
+private:
+  sqlite3_value* handle_{};
+};
+
+namespace detail {
+template<typename T>
+constexpr bool Is_blob_value = std::is_trivially_copyable_v<T> &&
+  !std::is_same_v<T, bool>;
+
+template<typename T>
+struct Is_data final : std::false_type {};
+
+template<typename T, unsigned char E>
+struct Is_data<Data<T, E>> final : std::true_type {};
+
+template<typename T>
+struct Is_span final : std::false_type {};
+
+template<typename T>
+struct Is_span<Span<T>> final : std::true_type {};
+
+/// The trait of contiguous sequences of trivially copyable values.
+template<typename T>
+struct Is_blob_sequence final : std::false_type {};
+
+template<typename T>
+struct Is_blob_sequence<Span<T>> final : std::true_type {};
+
+template<typename T>
+struct Is_blob_sequence<std::vector<T>> final
+  : std::bool_constant<Is_blob_value<T>> {};
+
+template<typename T, std::size_t N>
+struct Is_blob_sequence<std::array<T, N>> final
+  : std::bool_constant<Is_blob_value<T>> {};
+} // namespace detail
+
 } // namespace dmitigr::sqlixx
 
 #endif  // DMITIGR_SQLIXX_DATA_HPP
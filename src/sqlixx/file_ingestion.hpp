@@ -0,0 +1,270 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_FILE_INGESTION_HPP
+#define DMITIGR_SQLIXX_FILE_INGESTION_HPP
+
+#include "connection.hpp"
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+#include "../fs/filesystem.hpp"
+#include "../fs/misc.hpp"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/// The options of `ingest_files()`.
+struct File_ingestion_options final {
+  /**
+   * The extension of the files to ingest, for example, `.txt`. (The files
+   * without extension are ingested if empty.)
+   */
+  std::filesystem::path extension;
+
+  /// Whether to search the files recursively.
+  bool is_recursive{true};
+
+  /// The number of reader threads.
+  unsigned reader_count{std::max(std::thread::hardware_concurrency(), 2u) - 1};
+
+  /// The maximum number of files read but not yet written.
+  std::size_t queue_capacity{256};
+
+  /// The number of files to insert per transaction.
+  std::size_t batch_size{10000};
+};
+
+/// The statistics of `ingest_files()`.
+struct File_ingestion_stats final {
+  /// The number of files ingested.
+  std::uint64_t file_count{};
+
+  /// The total size of files ingested in bytes.
+  std::uint64_t byte_count{};
+
+  /// The duration of ingestion in seconds.
+  double seconds{};
+
+  /// @returns The number of files ingested per second.
+  double files_per_second() const noexcept
+  {
+    return seconds > 0 ? static_cast<double>(file_count) / seconds : 0;
+  }
+
+  /// @returns The number of megabytes ingested per second.
+  double megabytes_per_second() const noexcept
+  {
+    return seconds > 0 ? static_cast<double>(byte_count) / 1048576 / seconds : 0;
+  }
+};
+
+namespace detail {
+/// A file read by a reader thread of `ingest_files()`.
+struct Ingested_file final {
+  std::string path;
+  std::unique_ptr<char[]> data;
+  std::size_t size{};
+};
+
+inline Ingested_file read_ingested_file(const std::filesystem::path& path,
+  const std::filesystem::path& root)
+{
+  Ingested_file result;
+  result.path = path.lexically_relative(root).generic_string();
+  const std::unique_ptr<std::FILE, int(*)(std::FILE*)>
+    file{std::fopen(path.string().c_str(), "rb"), &std::fclose};
+  if (!file)
+    throw Exception{"cannot open file " + path.string()};
+  result.size = static_cast<std::size_t>(std::filesystem::file_size(path));
+  result.data.reset(new char[result.size ? result.size : 1]);
+  if (std::fread(result.data.get(), 1, result.size, file.get()) != result.size)
+    throw Exception{"cannot read file " + path.string()};
+  return result;
+}
+} // namespace detail
+
+/**
+ * @brief Inserts the files of the `root` directory into the database.
+ *
+ * @details The files are found by `fs::file_paths_by_extension()` and are read
+ * by `options.reader_count` threads in parallel. The contents are passed
+ * through the bounded queue to the calling thread which executes the `insert`
+ * statement with the path of the file relative to the `root` (as text) and
+ * the content of the file (as blob bound without copying) for each file, and
+ * commits every `options.batch_size` files. If an error occurs, the current
+ * batch is rolled back, the files inserted by the batches committed before
+ * remain in the database.
+ * In any case, the `insert` statement is reset and its parameters are bound
+ * with NULL upon return.
+ *
+ * @param insert The statement with two parameters, for example,
+ * `insert into files(path, data) values(?, ?)`.
+ *
+ * @par Requires
+ * `connection.handle() && !connection.is_transaction_active() && insert`.
+ */
+inline File_ingestion_stats ingest_files(Connection& connection,
+  Statement& insert, const std::filesystem::path& root,
+  const File_ingestion_options& options = {})
+{
+  namespace chrono = std::chrono;
+  if (!insert)
+    throw Exception{"cannot ingest files by using invalid statement"};
+  else if (!options.reader_count || !options.queue_capacity ||
+    !options.batch_size)
+    throw Exception{"cannot ingest files with invalid options"};
+
+  const auto start = chrono::steady_clock::now();
+  const auto paths = fs::file_paths_by_extension(root, options.extension,
+    options.is_recursive);
+
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<detail::Ingested_file> queue;
+  std::size_t done_reader_count{};
+  bool is_aborted{};
+  std::exception_ptr error;
+  std::atomic<std::size_t> next_path{};
+
+  const auto read = [&]
+  {
+    try {
+      while (true) {
+        const auto i = next_path.fetch_add(1, std::memory_order_relaxed);
+        if (i >= paths.size())
+          break;
+        auto file = detail::read_ingested_file(paths[i], root);
+        std::unique_lock lock{mutex};
+        not_full.wait(lock, [&]
+        {
+          return is_aborted || queue.size() < options.queue_capacity;
+        });
+        if (is_aborted)
+          return;
+        queue.push_back(std::move(file));
+        not_empty.notify_one();
+      }
+    } catch (...) {
+      const std::lock_guard lg{mutex};
+      if (!error)
+        error = std::current_exception();
+      is_aborted = true;
+      not_full.notify_all();
+    }
+    const std::lock_guard lg{mutex};
+    ++done_reader_count;
+    not_empty.notify_one();
+  };
+
+  const auto reader_count = std::min<std::size_t>(options.reader_count,
+    std::max<std::size_t>(paths.size(), 1));
+  std::vector<std::thread> readers;
+  const auto abort = [&]
+  {
+    {
+      const std::lock_guard lg{mutex};
+      is_aborted = true;
+    }
+    not_full.notify_all();
+    for (auto& reader : readers)
+      reader.join();
+  };
+  try {
+    for (std::size_t i = 0; i < reader_count; ++i)
+      readers.emplace_back(read);
+  } catch (...) {
+    abort();
+    throw;
+  }
+
+  // The statement must not refer to the data of the files after the return.
+  const auto release_insert = [&insert]
+  {
+    insert.reset();
+    insert.bind_null();
+  };
+  File_ingestion_stats result;
+  try {
+    connection.with_rollback_on_error([&]
+    {
+      std::size_t batch_count{};
+      while (true) {
+        detail::Ingested_file file;
+        {
+          std::unique_lock lock{mutex};
+          not_empty.wait(lock, [&]
+          {
+            return is_aborted || !queue.empty() ||
+              done_reader_count == readers.size();
+          });
+          if (error)
+            std::rethrow_exception(error);
+          else if (queue.empty())
+            break;
+          file = std::move(queue.front());
+          queue.pop_front();
+        }
+        not_full.notify_one();
+
+        if (!batch_count)
+          connection.execute("begin");
+        const Blob data{file.data.get(), file.size};
+        insert.execute(file.path, data);
+        result.byte_count += file.size;
+        ++result.file_count;
+        if (++batch_count == options.batch_size) {
+          connection.execute("commit");
+          batch_count = 0;
+        }
+      }
+      if (batch_count)
+        connection.execute("commit");
+    });
+  } catch (...) {
+    release_insert();
+    abort();
+    throw;
+  }
+  release_insert();
+  for (auto& reader : readers)
+    reader.join();
+  result.seconds = chrono::duration<double>(
+    chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_FILE_INGESTION_HPP
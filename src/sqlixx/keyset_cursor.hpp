@@ -0,0 +1,401 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_KEYSET_CURSOR_HPP
+#define DMITIGR_SQLIXX_KEYSET_CURSOR_HPP
+
+#include "connection.hpp"
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+namespace detail {
+/// @returns The `data` encoded as unpadded base64url.
+inline std::string base64url_encode(const std::string_view data)
+{
+  static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  std::string result;
+  result.reserve((data.size() * 4 + 2) / 3);
+  std::uint32_t bits{};
+  int bit_count{};
+  for (const char ch : data) {
+    bits = (bits << 8) | static_cast<unsigned char>(ch);
+    bit_count += 8;
+    while (bit_count >= 6) {
+      bit_count -= 6;
+      result += alphabet[(bits >> bit_count) & 0x3f];
+    }
+  }
+  if (bit_count)
+    result += alphabet[(bits << (6 - bit_count)) & 0x3f];
+  return result;
+}
+
+/// @returns The data decoded from unpadded base64url `str`.
+inline std::string base64url_decode(const std::string_view str)
+{
+  std::string result;
+  result.reserve(str.size() * 3 / 4);
+  std::uint32_t bits{};
+  int bit_count{};
+  for (const char ch : str) {
+    int value;
+    if ('A' <= ch && ch <= 'Z')
+      value = ch - 'A';
+    else if ('a' <= ch && ch <= 'z')
+      value = ch - 'a' + 26;
+    else if ('0' <= ch && ch <= '9')
+      value = ch - '0' + 52;
+    else if (ch == '-')
+      value = 62;
+    else if (ch == '_')
+      value = 63;
+    else
+      throw Exception{"invalid base64url character"};
+    bits = (bits << 6) | static_cast<std::uint32_t>(value);
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      result += static_cast<char>((bits >> bit_count) & 0xff);
+    }
+  }
+  return result;
+}
+} // namespace detail
+
+/**
+ * @brief A cursor for the keyset (seek) pagination.
+ *
+ * @details Unlike the pagination by `offset` which costs O(offset) per page,
+ * each page is selected as the rows which follow the key of the last row of
+ * the previous page by using the row value comparison, e.g.
+ *
+ * @code
+ * select * from (query) where (k1, k2) > (?, ?) order by k1, k2 limit N
+ * @endcode
+ *
+ * so, provided the index on the key, the deep pages cost the same as the first
+ * one. The statements of the first and the next pages are prepared once. The
+ * cursor position (the key of the last row fetched) can be serialized into a
+ * compact token to resume the pagination later, e.g. by another request of the
+ * UI backend.
+ *
+ * @remarks The key columns must be the unique and not null columns of the
+ * result of the query. To seek by the index, the key should be the index
+ * columns which follow the ones restricted by equality in the query, e.g. the
+ * key `id` of the query `select * from t where g = ?` with the index on
+ * `(g, id)`.
+ */
+class Keyset_cursor final {
+public:
+  /// The default constructor.
+  Keyset_cursor() = default;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param connection The connection to prepare the statements by.
+   * @param query The query to paginate. May contain parameters.
+   * @param key The names of the key columns of the `query` result.
+   * @param page_size The maximum number of rows per page.
+   * @param is_descending Whether the pages are ordered by the key descending.
+   *
+   * @par Requires
+   * `connection.handle() && !key.empty() && page_size > 0`.
+   */
+  Keyset_cursor(Connection& connection, const std::string_view query,
+    std::vector<std::string> key, const int page_size,
+    const bool is_descending = false)
+    : key_columns_(key.size())
+    , page_size_{page_size}
+  {
+    if (key.empty())
+      throw Exception{"cannot create keyset cursor with empty key"};
+    else if (page_size <= 0)
+      throw Exception{"cannot create keyset cursor with invalid page size"};
+
+    std::string keys;
+    std::string params;
+    std::string ordering;
+    for (const auto& column : key) {
+      if (!keys.empty()) {
+        keys += ", ";
+        params += ", ";
+        ordering += ", ";
+      }
+      const auto quoted = detail::quoted_identifier(column);
+      keys += quoted;
+      params += '?';
+      ordering.append(quoted).append(is_descending ? " desc" : "");
+    }
+    const auto select = std::string{"select * from ("}.append(query)
+      .append(")");
+    const auto suffix = std::string{" order by "}.append(ordering)
+      .append(" limit ").append(std::to_string(page_size));
+    first_ = connection.prepare(select + suffix);
+    next_ = connection.prepare(std::string{select}.append(" where (")
+      .append(keys).append(is_descending ? ") < (" : ") > (").append(params)
+      .append(")").append(suffix));
+    for (std::size_t i = 0; i < key.size(); ++i)
+      key_columns_[i] = first_.column_index_throw(key[i].c_str());
+  }
+
+  /**
+   * @brief Fetches the next page.
+   *
+   * @param callback The function to call for each row of the page with the
+   * argument of type `const Statement&`.
+   * @param values The values to bind to the parameters of the query.
+   *
+   * @par Requires
+   * `sizeof...(values)` is equal to the number of the parameters of the query.
+   *
+   * @returns The number of rows fetched, or `0` if `is_done()`.
+   */
+  template<typename F, typename ... Types>
+  std::size_t fetch(F&& callback, Types&& ... values)
+  {
+    if (!first_)
+      throw Exception{"cannot fetch page by invalid keyset cursor"};
+    else if (sizeof...(Types) != static_cast<std::size_t>(
+        first_.parameter_count()))
+      throw Exception{"cannot fetch page by keyset cursor with invalid number "
+        "of values"};
+    else if (is_done_)
+      return 0;
+
+    auto& statement = key_.empty() ? first_ : next_;
+    statement.reset();
+    statement.bind_many(std::forward<Types>(values)...);
+    if (!key_.empty()) {
+      bound_key_ = key_;
+      // The key parameters follow all the parameters of the query.
+      bind_key__(statement, next_.parameter_count() -
+        static_cast<int>(key_columns_.size()));
+    }
+    std::size_t count{};
+    statement.execute([this, &callback, &count](const Statement& s)
+    {
+      callback(s);
+      store_key__(s);
+      ++count;
+    });
+    is_done_ = count < static_cast<std::size_t>(page_size_);
+    return count;
+  }
+
+  /// @returns `true` if the last page is fetched.
+  bool is_done() const noexcept
+  {
+    return is_done_;
+  }
+
+  /// @returns The maximum number of rows per page.
+  int page_size() const noexcept
+  {
+    return page_size_;
+  }
+
+  /// Positions the cursor before the first page.
+  void rewind() noexcept
+  {
+    key_.clear();
+    is_done_ = false;
+  }
+
+  /**
+   * @returns The token of the cursor position, which is empty if the cursor
+   * is positioned before the first page.
+   *
+   * @remarks The token consists of the base64url characters only.
+   *
+   * @see set_token().
+   */
+  std::string token() const
+  {
+    return detail::base64url_encode(key_);
+  }
+
+  /**
+   * @brief Positions the cursor after the row with the key encoded in `token`.
+   *
+   * @par Requires
+   * `token` is either empty or returned by `token()` of the cursor with the
+   * same key.
+   */
+  void set_token(const std::string_view token)
+  {
+    auto key = detail::base64url_decode(token);
+    // Validate the key.
+    if (!key.empty()) {
+      std::size_t offset{};
+      for (std::size_t i = 0; i < key_columns_.size(); ++i)
+        offset = next_key_value__(key, offset);
+      if (offset != key.size())
+        throw Exception{"invalid keyset cursor token"};
+    }
+    key_ = std::move(key);
+    is_done_ = false;
+  }
+
+private:
+  std::vector<int> key_columns_;
+  int page_size_{};
+  bool is_done_{};
+  Statement first_;
+  Statement next_;
+  /*
+   * The key of the last row fetched, serialized as the sequence of values
+   * each of which is the type byte followed by the 8-byte little-endian
+   * integer or real, or by the 4-byte little-endian size and the bytes of the
+   * text or the blob.
+   */
+  std::string key_;
+  std::string bound_key_; // the copy of key_ bound with SQLITE_STATIC
+
+  static void append_uint__(std::string& result, std::uint64_t value,
+    const int size)
+  {
+    for (int i = 0; i < size; ++i, value >>= 8)
+      result += static_cast<char>(value & 0xff);
+  }
+
+  static std::uint64_t read_uint__(const std::string& key,
+    const std::size_t offset, const int size)
+  {
+    if (key.size() - offset < static_cast<std::size_t>(size))
+      throw Exception{"invalid keyset cursor token"};
+    std::uint64_t result{};
+    for (int i = size - 1; i >= 0; --i)
+      result = (result << 8) |
+        static_cast<unsigned char>(key[offset + static_cast<std::size_t>(i)]);
+    return result;
+  }
+
+  /// @returns The offset of the value which follows the value at `offset`.
+  static std::size_t next_key_value__(const std::string& key,
+    std::size_t offset)
+  {
+    if (!(offset < key.size()))
+      throw Exception{"invalid keyset cursor token"};
+    switch (key[offset++]) {
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+      if (key.size() - offset < 8)
+        throw Exception{"invalid keyset cursor token"};
+      return offset + 8;
+    case SQLITE_TEXT:
+    case SQLITE_BLOB: {
+      const auto size = read_uint__(key, offset, 4);
+      offset += 4;
+      if (key.size() - offset < size)
+        throw Exception{"invalid keyset cursor token"};
+      return offset + static_cast<std::size_t>(size);
+    }
+    default:
+      throw Exception{"invalid keyset cursor token"};
+    }
+  }
+
+  void store_key__(const Statement& statement)
+  {
+    sqlite3_stmt* const handle = statement.handle();
+    key_.clear();
+    for (const int column : key_columns_) {
+      const int type = sqlite3_column_type(handle, column);
+      key_ += static_cast<char>(type);
+      switch (type) {
+      case SQLITE_INTEGER:
+        append_uint__(key_, static_cast<std::uint64_t>(
+            sqlite3_column_int64(handle, column)), 8);
+        break;
+      case SQLITE_FLOAT: {
+        const double value = sqlite3_column_double(handle, column);
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        append_uint__(key_, bits, 8);
+        break;
+      }
+      case SQLITE_TEXT:
+      case SQLITE_BLOB: {
+        const auto* const data = type == SQLITE_TEXT ?
+          static_cast<const void*>(sqlite3_column_text(handle, column)) :
+          sqlite3_column_blob(handle, column);
+        const auto size = sqlite3_column_bytes(handle, column);
+        append_uint__(key_, static_cast<std::uint64_t>(size), 4);
+        if (size)
+          key_.append(static_cast<const char*>(data),
+            static_cast<std::size_t>(size));
+        break;
+      }
+      default:
+        key_.clear();
+        throw Exception{"cannot use NULL as key of keyset cursor"};
+      }
+    }
+  }
+
+  void bind_key__(Statement& statement, int index) const
+  {
+    std::size_t offset{};
+    for (std::size_t i = 0; i < key_columns_.size(); ++i, ++index) {
+      const int type = bound_key_[offset];
+      const auto next = next_key_value__(bound_key_, offset);
+      ++offset;
+      switch (type) {
+      case SQLITE_INTEGER:
+        statement.bind(index, static_cast<sqlite3_int64>(
+            read_uint__(bound_key_, offset, 8)));
+        break;
+      case SQLITE_FLOAT: {
+        const auto bits = read_uint__(bound_key_, offset, 8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        statement.bind(index, value);
+        break;
+      }
+      case SQLITE_TEXT: {
+        const std::string_view value{bound_key_.data() + offset + 4,
+          next - offset - 4};
+        statement.bind(index, value);
+        break;
+      }
+      default: {
+        const Blob value{bound_key_.data() + offset + 4, next - offset - 4};
+        statement.bind(index, value);
+      }
+      }
+      offset = next;
+    }
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_KEYSET_CURSOR_HPP
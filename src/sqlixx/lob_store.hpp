@@ -0,0 +1,493 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_LOB_STORE_HPP
+#define DMITIGR_SQLIXX_LOB_STORE_HPP
+
+#include "connection.hpp"
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+#include "../fs/filesystem.hpp"
+
+#include <sqlite3.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/**
+ * @brief A large object read from Lob_store.
+ *
+ * @details The content stored in the external file is memory-mapped (on POSIX
+ * systems), the content stored inline is copied.
+ */
+class Lob final {
+public:
+  /// The destructor.
+  ~Lob()
+  {
+#ifndef _WIN32
+    if (mapping_)
+      ::munmap(mapping_, size_);
+#endif
+  }
+
+  /// The default constructor.
+  Lob() = default;
+
+  /// Non-copyable.
+  Lob(const Lob&) = delete;
+
+  /// Non-copyable.
+  Lob& operator=(const Lob&) = delete;
+
+  /// The move constructor.
+  Lob(Lob&& rhs) noexcept
+    : data_{rhs.data_}
+    , size_{rhs.size_}
+    , mapping_{rhs.mapping_}
+    , copy_{std::move(rhs.copy_)}
+  {
+    rhs.data_ = {};
+    rhs.size_ = {};
+    rhs.mapping_ = {};
+  }
+
+  /// The move assignment operator.
+  Lob& operator=(Lob&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      Lob tmp{std::move(rhs)};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /// The swap operation.
+  void swap(Lob& other) noexcept
+  {
+    using std::swap;
+    swap(data_, other.data_);
+    swap(size_, other.size_);
+    swap(mapping_, other.mapping_);
+    swap(copy_, other.copy_);
+  }
+
+  /// @returns The data.
+  const void* data() const noexcept { return data_; }
+
+  /// @returns The data size.
+  std::size_t size() const noexcept { return size_; }
+
+  /// @returns `true` if the data is memory-mapped.
+  bool is_mapped() const noexcept { return mapping_; }
+
+  /// @returns The view of the data valid until this instance is destroyed.
+  Blob blob() const noexcept
+  {
+    return Blob{data_, size_};
+  }
+
+private:
+  friend class Lob_store;
+
+  const void* data_{};
+  std::size_t size_{};
+  void* mapping_{};
+  std::unique_ptr<char[]> copy_;
+};
+
+/**
+ * @brief An external storage of large objects.
+ *
+ * @details The objects of at least `threshold()` bytes are stored in the files
+ * of the managed directory and only their names are stored in the table, so
+ * they don't bloat the database, slow down `VACUUM` and pollute the page
+ * cache. The smaller objects are stored inline in the table. An object is
+ * identified by its row identifier, which is to be stored in the rows of the
+ * application tables instead of the object itself.
+ *
+ * The store is crash-safe relative to the transactions provided the table and
+ * the directory are modified only by using the instances of this class:
+ *   - the row of the object is inserted under the savepoint, then the file is
+ *   written to the temporary file which is synchronized and renamed, and only
+ *   then the savepoint is released (and committed if there is no transaction),
+ *   so the committed row always refers to the complete file, and the failed
+ *   insertion leaves neither the row nor the file;
+ *   - the file of the removed object is not removed immediately, but queued
+ *   in the table to be removed by `purge()` after commit, so the rolled back
+ *   removal leaves the file intact;
+ *   - the files left by the rolled back insertions or by crashes are removed
+ *   by `collect_garbage()`.
+ *
+ * @remarks The instance must not outlive the connection.
+ */
+class Lob_store final {
+public:
+  /// The default name of the table.
+  static constexpr const char* default_name{"sqlixx_lobs"};
+
+  /// The default threshold.
+  static constexpr std::size_t default_threshold{std::size_t{1} << 20};
+
+  /**
+   * @brief Creates the directory and the tables (if not exist) and prepares
+   * the statements.
+   *
+   * @par Requires
+   * `connection.handle()`.
+   */
+  Lob_store(Connection& connection, std::filesystem::path directory,
+    const std::size_t threshold = default_threshold,
+    const std::string& name = default_name)
+    : connection_{&connection}
+    , directory_{std::move(directory)}
+    , threshold_{threshold}
+  {
+    std::filesystem::create_directories(directory_);
+    const auto lobs = detail::quoted_identifier(name);
+    const auto trash = detail::quoted_identifier(name + "_trash");
+    connection.execute_script("create table if not exists " + lobs +
+      "(id integer primary key, size integer not null, data blob, file text);"
+      " create table if not exists " + trash + "(file text primary key)");
+    insert_ = connection.prepare("insert into " + lobs +
+      "(size, data, file) values(?, ?, ?)");
+    select_ = connection.prepare("select size, data, file from " + lobs +
+      " where id = ?");
+    delete_ = connection.prepare("delete from " + lobs + " where id = ?");
+    trash_ = connection.prepare("insert or ignore into " + trash +
+      " values(?)");
+    select_trash_ = connection.prepare("select file from " + trash);
+    delete_trash_ = connection.prepare("delete from " + trash +
+      " where file = ?");
+    select_files_ = connection.prepare("select file from " + lobs +
+      " where file is not null");
+  }
+
+  /// @returns The directory of the files.
+  const std::filesystem::path& directory() const noexcept
+  {
+    return directory_;
+  }
+
+  /// @returns The minimum size of the object stored in the file.
+  std::size_t threshold() const noexcept
+  {
+    return threshold_;
+  }
+
+  /**
+   * @brief Stores the `data` of `size` bytes.
+   *
+   * @details Should be called in the transaction to make the insertion atomic
+   * with the insertion of the reference to the object.
+   *
+   * @returns The identifier of the object.
+   */
+  sqlite3_int64 put(const void* const data, const std::size_t size)
+  {
+    if (size < threshold_) {
+      const Span<char> value{static_cast<const char*>(data), size};
+      insert_.execute(static_cast<sqlite3_int64>(size), value,
+        std::optional<std::string>{});
+      return sqlite3_last_insert_rowid(connection_->handle());
+    }
+
+    const auto file = make_file_name__();
+    const auto path = directory_ / file;
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    connection_->execute("savepoint sqlixx_lob_store");
+    try {
+      // The row is inserted first to acquire the write lock, so
+      // collect_garbage() cannot remove the file before the transaction is
+      // ended.
+      insert_.execute(static_cast<sqlite3_int64>(size),
+        std::optional<std::string>{}, file);
+      const auto result = sqlite3_last_insert_rowid(connection_->handle());
+      write_file__(tmp_path, data, size);
+      std::filesystem::rename(tmp_path, path);
+      sync_directory__();
+      connection_->execute("release sqlixx_lob_store");
+      return result;
+    } catch (...) {
+      insert_.reset();
+      std::error_code ec;
+      std::filesystem::remove(tmp_path, ec);
+      std::filesystem::remove(path, ec);
+      try {
+        connection_->execute("rollback to sqlixx_lob_store");
+        connection_->execute("release sqlixx_lob_store");
+      } catch (...) {
+        std::throw_with_nested(Exception{"SQLite ROLLBACK TO failed"});
+      }
+      throw;
+    }
+  }
+
+  /// @overload
+  sqlite3_int64 put(const Blob& data)
+  {
+    return put(data.data(), static_cast<std::size_t>(data.size()));
+  }
+
+  /**
+   * @returns The object by `id`.
+   *
+   * @throws Exception if there is no object with the `id`.
+   */
+  Lob get(const sqlite3_int64 id)
+  {
+    Lob result;
+    std::string file;
+    bool is_found{};
+    select_.execute([&](const Statement& s)
+    {
+      is_found = true;
+      result.size_ = static_cast<std::size_t>(s.result<sqlite3_int64>(0));
+      if (sqlite3_column_type(s.handle(), 2) == SQLITE_NULL) {
+        result.copy_.reset(new char[result.size_ ? result.size_ : 1]);
+        if (result.size_)
+          std::memcpy(result.copy_.get(), s.result<Blob>(1).data(), result.size_);
+        result.data_ = result.copy_.get();
+      } else
+        file = s.result<std::string>(2);
+    }, id);
+    if (!is_found)
+      throw Exception{"no large object " + std::to_string(id)};
+    else if (!file.empty())
+      map_file__(directory_ / file, result);
+    return result;
+  }
+
+  /**
+   * @brief Removes the object by `id`.
+   *
+   * @details The file of the object is queued to be removed by `purge()`.
+   *
+   * @returns `false` if there is no object with the `id`.
+   */
+  bool remove(const sqlite3_int64 id)
+  {
+    bool result{};
+    std::optional<std::string> file;
+    select_.execute([&](const Statement& s)
+    {
+      result = true;
+      file = s.result<std::optional<std::string>>(2);
+    }, id);
+    if (result)
+      delete_.execute(id);
+    if (file)
+      trash_.execute(*file);
+    return result;
+  }
+
+  /**
+   * @brief Removes the files of the objects removed by the committed
+   * transactions.
+   *
+   * @returns The number of files removed.
+   *
+   * @par Requires
+   * `!connection.is_transaction_active()`.
+   */
+  std::size_t purge()
+  {
+    if (connection_->is_transaction_active())
+      throw Exception{"cannot purge large object store in transaction"};
+
+    std::vector<std::string> files;
+    select_trash_.execute([&files](const Statement& s)
+    {
+      files.push_back(s.result<std::string>(0));
+    });
+    for (const auto& file : files) {
+      std::error_code ec;
+      std::filesystem::remove(directory_ / file, ec);
+      if (ec)
+        throw std::system_error{ec, "cannot remove large object file " + file};
+      delete_trash_.execute(file);
+    }
+    return files.size();
+  }
+
+  /**
+   * @brief Removes the files which are not referenced by the objects: the
+   * files of the rolled back insertions and the temporary files left by
+   * crashes.
+   *
+   * @details Scans the whole directory in the immediate transaction, which
+   * excludes the concurrent insertions by other connections.
+   *
+   * @returns The number of files removed.
+   *
+   * @par Requires
+   * `!connection.is_transaction_active()`.
+   */
+  std::size_t collect_garbage()
+  {
+    if (connection_->is_transaction_active())
+      throw Exception{"cannot collect garbage of large object store in "
+        "transaction"};
+
+    connection_->execute("begin immediate");
+    return connection_->with_rollback_on_error([&]
+    {
+      std::vector<std::string> files;
+      select_files_.execute([&files](const Statement& s)
+      {
+        files.push_back(s.result<std::string>(0));
+      });
+      std::sort(files.begin(), files.end());
+      std::size_t result{};
+      for (const auto& entry : std::filesystem::directory_iterator{directory_}) {
+        const auto name = entry.path().filename().string();
+        if (entry.is_regular_file() &&
+          !std::binary_search(files.begin(), files.end(), name)) {
+          std::filesystem::remove(entry.path());
+          ++result;
+        }
+      }
+      connection_->execute("commit");
+      return result;
+    });
+  }
+
+private:
+  Connection* connection_{};
+  std::filesystem::path directory_;
+  std::size_t threshold_{};
+  std::mt19937_64 random_{std::random_device{}()};
+  Statement insert_;
+  Statement select_;
+  Statement delete_;
+  Statement trash_;
+  Statement select_trash_;
+  Statement delete_trash_;
+  Statement select_files_;
+
+  std::string make_file_name__()
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    for (int i = 0; i < 2; ++i) {
+      auto value = random_();
+      for (int j = 0; j < 16; ++j, value >>= 4)
+        result += digits[value & 0xf];
+    }
+    return result.append(".lob");
+  }
+
+  static void write_file__(const std::filesystem::path& path,
+    const void* const data, const std::size_t size)
+  {
+#ifdef _WIN32
+    const std::unique_ptr<std::FILE, int(*)(std::FILE*)>
+      file{_wfopen(path.c_str(), L"wb"), &std::fclose};
+#else
+    const std::unique_ptr<std::FILE, int(*)(std::FILE*)>
+      file{std::fopen(path.c_str(), "wb"), &std::fclose};
+#endif
+    if (!file)
+      throw Exception{"cannot open large object file " + path.string()};
+    else if (std::fwrite(data, 1, size, file.get()) != size ||
+      std::fflush(file.get()))
+      throw Exception{"cannot write large object file " + path.string()};
+#ifdef _WIN32
+    if (_commit(_fileno(file.get())))
+#else
+    if (::fsync(::fileno(file.get())))
+#endif
+      throw Exception{"cannot synchronize large object file " + path.string()};
+  }
+
+  void sync_directory__() const
+  {
+#ifndef _WIN32
+    const int fd = ::open(directory_.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw Exception{"cannot open large object directory " + directory_.string()};
+    const int r = ::fsync(fd);
+    ::close(fd);
+    if (r)
+      throw Exception{"cannot synchronize large object directory " +
+        directory_.string()};
+#endif
+  }
+
+  static void map_file__(const std::filesystem::path& path, Lob& lob)
+  {
+#ifdef _WIN32
+    const std::unique_ptr<std::FILE, int(*)(std::FILE*)>
+      file{_wfopen(path.c_str(), L"rb"), &std::fclose};
+    if (!file)
+      throw Exception{"cannot open large object file " + path.string()};
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) != lob.size_ || ec)
+      throw Exception{"large object file " + path.string() + " is not of "
+        "the stored size"};
+    lob.copy_.reset(new char[lob.size_ ? lob.size_ : 1]);
+    if (std::fread(lob.copy_.get(), 1, lob.size_, file.get()) != lob.size_)
+      throw Exception{"cannot read large object file " + path.string()};
+    lob.data_ = lob.copy_.get();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw Exception{"cannot open large object file " + path.string()};
+    // Accessing the mapping beyond the end of the file raises SIGBUS.
+    struct stat st;
+    if (::fstat(fd, &st) || static_cast<std::uintmax_t>(st.st_size) != lob.size_) {
+      ::close(fd);
+      throw Exception{"large object file " + path.string() + " is not of "
+        "the stored size"};
+    }
+    void* const mapping = lob.size_ ?
+      ::mmap(nullptr, lob.size_, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+      throw Exception{"cannot map large object file " + path.string()};
+    lob.mapping_ = mapping;
+    lob.data_ = mapping;
+#endif
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_LOB_STORE_HPP
@@ -0,0 +1,247 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_MIGRATION_RUNNER_HPP
+#define DMITIGR_SQLIXX_MIGRATION_RUNNER_HPP
+
+#include "connection.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+#include "../fs/filesystem.hpp"
+#include "../fs/misc.hpp"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/// A migration.
+struct Migration final {
+  /// The version (the path relative to the root without the extension).
+  std::string version;
+
+  /// The path to the file.
+  std::filesystem::path path;
+
+  /// The SQL script.
+  std::string sql;
+
+  /// The checksum of the SQL script.
+  sqlite3_int64 checksum{};
+};
+
+/**
+ * @brief A runner of migrations stored in the files.
+ *
+ * @details The migrations are read from the `*.sql` files of the directory
+ * tree, and are ordered by the versions, which are the paths of the files
+ * relative to the root without the extension (for example, `0001_init` or
+ * `v2/0001_users`). The versions and the checksums of applied migrations are
+ * stored in the metadata table. In addition, the combined checksum of all the
+ * migrations is stored, which allows to skip the whole run at the cost of a
+ * single point query if nothing changed since the last run.
+ *
+ * @remarks The migration scripts must not control transactions, since the
+ * pending migrations are applied in one transaction.
+ */
+class Migration_runner final {
+public:
+  /// The default name of the metadata table.
+  static constexpr const char* default_table{"sqlixx_migrations"};
+
+  /**
+   * @brief Reads the migrations from the `*.sql` files of the `root`
+   * directory tree.
+   *
+   * @param table The name of the metadata table. The combined checksum is
+   * stored in the table with the name `table` suffixed with `_state`.
+   *
+   * @par Requires
+   * `std::filesystem::is_directory(root) && !table.empty()`.
+   */
+  explicit Migration_runner(const std::filesystem::path& root,
+    std::string table = default_table)
+    : table_{std::move(table)}
+  {
+    if (table_.empty())
+      throw Exception{"cannot create migration runner with empty table name"};
+    else if (!std::filesystem::is_directory(root))
+      throw Exception{"cannot create migration runner with non-directory "
+        "root " + root.string()};
+
+    const auto paths = fs::file_paths_by_extension(root, ".sql", true);
+    migrations_.reserve(paths.size());
+    for (const auto& path : paths) {
+      std::ifstream file{path, std::ios_base::binary};
+      if (!file)
+        throw Exception{"cannot open migration file " + path.string()};
+      Migration migration;
+      migration.version = path.lexically_relative(root)
+        .replace_extension().generic_string();
+      migration.path = path;
+      migration.sql.assign(std::istreambuf_iterator<char>{file},
+        std::istreambuf_iterator<char>{});
+      migration.checksum = hash(migration.sql);
+      migrations_.push_back(std::move(migration));
+    }
+    std::sort(migrations_.begin(), migrations_.end(),
+      [](const auto& lhs, const auto& rhs)
+      {
+        return lhs.version < rhs.version;
+      });
+
+    std::string combined;
+    for (const auto& migration : migrations_) {
+      combined.append(migration.version).append(1, '\0');
+      // The checksum is appended as little-endian regardless of the platform.
+      auto value = static_cast<std::uint64_t>(migration.checksum);
+      for (std::size_t i = 0; i < sizeof(value); ++i, value >>= 8)
+        combined += static_cast<char>(value & 0xff);
+    }
+    checksum_ = hash(combined);
+  }
+
+  /// @returns The migrations ordered by the versions.
+  const std::vector<Migration>& migrations() const noexcept
+  {
+    return migrations_;
+  }
+
+  /// @returns The combined checksum of all the migrations.
+  sqlite3_int64 checksum() const noexcept
+  {
+    return checksum_;
+  }
+
+  /// @returns The name of the metadata table.
+  const std::string& table() const noexcept
+  {
+    return table_;
+  }
+
+  /**
+   * @brief Applies the pending migrations in one transaction.
+   *
+   * @details Does nothing if the stored combined checksum equals to
+   * `checksum()`.
+   *
+   * @returns The number of migrations applied.
+   *
+   * @throws Exception if the checksum of the applied migration doesn't match
+   * the checksum of its file.
+   *
+   * @par Requires
+   * `connection.handle() && !connection.is_transaction_active()`.
+   */
+  std::size_t run(Connection& connection) const
+  {
+    if (stored_checksum(connection) == checksum_)
+      return 0;
+
+    const auto table = detail::quoted_identifier(table_);
+    const auto state = detail::quoted_identifier(table_ + "_state");
+    connection.execute("begin immediate");
+    return connection.with_rollback_on_error([&]
+    {
+      connection.execute_script(std::string{"create table if not exists "}
+        .append(table).append("(version text primary key,"
+          " checksum integer not null,"
+          " applied_at text not null default current_timestamp);"
+          " create table if not exists ").append(state)
+        .append("(id integer primary key check(id = 1),"
+          " checksum integer not null)"));
+
+      std::map<std::string, sqlite3_int64> applied;
+      connection.execute([&applied](const Statement& s)
+      {
+        applied.emplace(s.result<std::string>(0), s.result<sqlite3_int64>(1));
+      }, "select version, checksum from " + table);
+
+      std::size_t result{};
+      Statement insert;
+      for (const auto& migration : migrations_) {
+        if (const auto i = applied.find(migration.version); i != applied.end()) {
+          if (i->second != migration.checksum)
+            throw Exception{"checksum mismatch of applied migration " +
+              migration.version};
+          continue;
+        }
+        connection.execute_script(migration.sql);
+        if (!insert)
+          insert = connection.prepare("insert into " + table +
+            "(version, checksum) values(?, ?)");
+        insert.execute(migration.version, migration.checksum);
+        ++result;
+      }
+      connection.execute("insert or replace into " + state +
+        "(id, checksum) values(1, ?)", checksum_);
+      connection.execute("commit");
+      return result;
+    });
+  }
+
+  /**
+   * @returns The combined checksum stored by the last run, or `0` if no run
+   * was done on the database.
+   */
+  sqlite3_int64 stored_checksum(Connection& connection) const
+  {
+    const std::string state = table_ + "_state";
+    bool is_exists{};
+    connection.execute([&is_exists](const Statement&)
+    {
+      is_exists = true;
+    }, "select 1 from sqlite_master where type = 'table' and name = ?", state);
+    sqlite3_int64 result{};
+    if (is_exists)
+      connection.execute([&result](const Statement& s)
+      {
+        result = s.result<sqlite3_int64>(0);
+      }, "select checksum from " + detail::quoted_identifier(state) +
+        " where id = 1");
+    return result;
+  }
+
+  /// @returns The 64-bit FNV-1a hash of `data`.
+  static sqlite3_int64 hash(const std::string_view data) noexcept
+  {
+    std::uint64_t result{14695981039346656037ull};
+    for (const char ch : data) {
+      result ^= static_cast<unsigned char>(ch);
+      result *= 1099511628211ull;
+    }
+    return static_cast<sqlite3_int64>(result);
+  }
+
+private:
+  std::string table_;
+  std::vector<Migration> migrations_;
+  sqlite3_int64 checksum_{};
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_MIGRATION_RUNNER_HPP
@@ -0,0 +1,208 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_READ_ONLY_CONNECTION_HPP
+#define DMITIGR_SQLIXX_READ_ONLY_CONNECTION_HPP
+
+#include "connection.hpp"
+#include "connection_options.hpp"
+#include "statement.hpp"
+#include "statement_catalog.hpp"
+#include "../fs/filesystem.hpp"
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace dmitigr::sqlixx {
+
+/**
+ * @brief A read-only database connection.
+ *
+ * @details The connection is opened with `SQLITE_OPEN_READONLY` and
+ * `SQLITE_OPEN_NOMUTEX` and with `query_only` pragma set, and provides only
+ * the API to prepare and execute statements which don't modify the database.
+ * Since the connection has no internal mutex, an instance must not be used by
+ * several threads concurrently: the intended usage is an instance per thread.
+ */
+class Read_only_connection final {
+public:
+  /// The default size of memory-mapped I/O.
+  static constexpr sqlite3_int64 default_mmap_size{sqlite3_int64{1} << 30};
+
+  /// The constructor.
+  Read_only_connection() = default;
+
+  /**
+   * @brief Opens the read-only connection to the database at `path`.
+   *
+   * @param options The options to apply. If `options.mmap_size()` is not set
+   * the `default_mmap_size` is used.
+   * @param is_immutable If `true`, the database is opened with `immutable=1`
+   * URI parameter: SQLite assumes the database can not be changed (even by
+   * other processes), and neither uses locks nor checks for changes.
+   *
+   * @par Requires
+   * `!options.page_size() && !options.journal_mode() && !options.synchronous()
+   * && !options.wal_autocheckpoint()`.
+   */
+  explicit Read_only_connection(const std::filesystem::path& path,
+    Connection_options options = {}, const bool is_immutable = false)
+  {
+    if (options.page_size() || options.journal_mode() ||
+      options.synchronous() || options.wal_autocheckpoint())
+      throw Exception{"cannot open read-only SQLite connection with options "
+        "for writing"};
+    if (!options.mmap_size())
+      options.set_mmap_size(default_mmap_size);
+
+    std::string uri{"file:"};
+    for (const char c : path.generic_u8string()) {
+      if (c == '%' || c == '?' || c == '#') {
+        char buf[4];
+        std::snprintf(buf, sizeof(buf), "%%%02X", static_cast<unsigned char>(c));
+        uri.append(buf);
+      } else
+        uri += c;
+    }
+    if (is_immutable)
+      uri.append("?immutable=1");
+    conn_ = Connection{uri, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX |
+      SQLITE_OPEN_URI, options};
+    conn_.execute("pragma query_only = 1");
+  }
+
+  /// @returns The guarded handle.
+  sqlite3* handle() const noexcept
+  {
+    return conn_.handle();
+  }
+
+  /// @returns `true` if this object keeps handle, or `false` otherwise.
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(conn_);
+  }
+
+  /// Closes the database connection.
+  void close()
+  {
+    conn_.close();
+  }
+
+  /// @see Connection::lookaside_status().
+  Lookaside_status lookaside_status(const bool reset = false) const
+  {
+    return conn_.lookaside_status(reset);
+  }
+
+  /**
+   * @returns An instance of type Statement.
+   *
+   * @par Requires
+   * The `sql` must not modify the database.
+   *
+   * @see Connection::prepare().
+   */
+  Statement prepare(const std::string_view sql, const unsigned int flags = 0)
+  {
+    return check_read_only(conn_.prepare(sql, flags));
+  }
+
+  /// @see Connection::set_capture().
+  void set_capture(std::shared_ptr<Capture_writer> capture) noexcept
+  {
+    conn_.set_capture(std::move(capture));
+  }
+
+  /// @returns The capture writer.
+  const std::shared_ptr<Capture_writer>& capture() const noexcept
+  {
+    return conn_.capture();
+  }
+
+  /// @see Connection::set_statement_catalog().
+  void set_statement_catalog(std::shared_ptr<const Statement_catalog> catalog)
+  {
+    conn_.set_statement_catalog(std::move(catalog));
+  }
+
+  /// @returns The statement catalog.
+  const std::shared_ptr<const Statement_catalog>& statement_catalog() const noexcept
+  {
+    return conn_.statement_catalog();
+  }
+
+  /**
+   * @returns The statement of the statement catalog by the `id`.
+   *
+   * @par Requires
+   * The statement must not modify the database.
+   *
+   * @see Connection::statement().
+   */
+  Statement& statement(const std::size_t id)
+  {
+    return check_read_only(conn_.statement(id));
+  }
+
+  /**
+   * @brief Executes the `sql`.
+   *
+   * @par Requires
+   * The `sql` must not modify the database.
+   *
+   * @see Connection::execute().
+   */
+  template<typename F, typename ... Types>
+  std::enable_if_t<detail::Execute_callback_traits<F>::is_valid>
+  execute(F&& callback, const std::string_view sql, Types&& ... values)
+  {
+    if (!conn_)
+      throw Exception{"cannot execute SQLite statement using invalid connection"};
+
+    prepare(sql).execute(std::forward<F>(callback), std::forward<Types>(values)...);
+  }
+
+  /// @overload
+  template<typename ... Types>
+  void execute(const std::string_view sql, Types&& ... values)
+  {
+    execute([](const auto&){ return true; }, sql, std::forward<Types>(values)...);
+  }
+
+private:
+  Connection conn_;
+
+  template<typename S>
+  static S&& check_read_only(S&& statement)
+  {
+    if (!sqlite3_stmt_readonly(statement.handle()))
+      throw Exception{"cannot prepare SQLite statement which modifies the "
+        "database using read-only connection"};
+    return std::forward<S>(statement);
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_READ_ONLY_CONNECTION_HPP
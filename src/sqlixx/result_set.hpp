@@ -0,0 +1,382 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_RESULT_SET_HPP
+#define DMITIGR_SQLIXX_RESULT_SET_HPP
+
+#include "data.hpp"
+#include "exceptions.hpp"
+#include "statement.hpp"
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+/**
+ * @brief A materialized result of statement execution.
+ *
+ * @details The values of all the rows are copied into one contiguous buffer
+ * as type-tagged cells, and are located by the flat index of cell offsets.
+ * Thus, the values are not allocated one by one, and the buffers are grown
+ * geometrically (or are allocated once if reserved by `reserve()` in
+ * advance). The result set doesn't refer to the statement or the connection,
+ * and can be moved or copied across threads and cached as is.
+ */
+class Result_set final {
+public:
+  /// The default constructor.
+  Result_set() = default;
+
+  /**
+   * @brief Executes the `statement` with the `values` bound and copies all
+   * the rows of the result.
+   *
+   * @see Statement::execute().
+   */
+  template<typename ... Types>
+  explicit Result_set(Statement& statement, Types&& ... values)
+  {
+    set_columns__(statement);
+    statement.execute([this](const Statement& s)
+    {
+      append(s);
+    }, std::forward<Types>(values)...);
+  }
+
+  /**
+   * @brief Appends the current row of the `statement`.
+   *
+   * @details Useful to collect the rows selectively from the callback of
+   * `Statement::execute()`. If the column names are not known yet, they are
+   * taken from the `statement`.
+   *
+   * @par Requires
+   * `statement.handle()` with the current row, which has the same number of
+   * columns as the rows appended before.
+   */
+  void append(const Statement& statement)
+  {
+    sqlite3_stmt* const handle = statement.handle();
+    if (!handle)
+      throw Exception{"cannot append row of invalid SQLite statement to "
+        "result set"};
+
+    const int count = sqlite3_column_count(handle);
+    if (column_names_.empty() && offsets_.empty())
+      set_columns__(statement);
+    else if (count != column_count())
+      throw Exception{"cannot append row with different number of columns to "
+        "result set"};
+
+    for (int i = 0; i < count; ++i) {
+      offsets_.push_back(data_.size());
+      const int type = sqlite3_column_type(handle, i);
+      data_.push_back(static_cast<char>(type));
+      switch (type) {
+      case SQLITE_INTEGER:
+        append_bytes__(sqlite3_column_int64(handle, i));
+        break;
+      case SQLITE_FLOAT:
+        append_bytes__(sqlite3_column_double(handle, i));
+        break;
+      case SQLITE_TEXT: {
+        // The text is stored with the terminating zero like SQLite does.
+        const auto* const text = sqlite3_column_text(handle, i);
+        const auto size = static_cast<std::size_t>(sqlite3_column_bytes(handle, i));
+        append_bytes__(static_cast<std::uint64_t>(size));
+        data_.insert(data_.end(), text, text + size);
+        data_.push_back('\0');
+        break;
+      }
+      case SQLITE_BLOB: {
+        const auto* const blob =
+          static_cast<const char*>(sqlite3_column_blob(handle, i));
+        const auto size = static_cast<std::size_t>(sqlite3_column_bytes(handle, i));
+        append_bytes__(static_cast<std::uint64_t>(size));
+        if (size)
+          data_.insert(data_.end(), blob, blob + size);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+
+  /// @returns The number of rows.
+  std::size_t row_count() const noexcept
+  {
+    return column_names_.empty() ? 0 : offsets_.size() / column_names_.size();
+  }
+
+  /// @returns `!row_count()`.
+  bool is_empty() const noexcept
+  {
+    return offsets_.empty();
+  }
+
+  /// @returns The number of columns.
+  int column_count() const noexcept
+  {
+    return static_cast<int>(column_names_.size());
+  }
+
+  /**
+   * @returns The name of the column by the `index`.
+   *
+   * @par Requires
+   * `index < column_count()`.
+   */
+  const std::string& column_name(const int index) const
+  {
+    if (!(0 <= index && index < column_count()))
+      throw Exception{"cannot get column name of result set using invalid "
+        "index"};
+    return column_names_[static_cast<std::size_t>(index)];
+  }
+
+  /// @returns The column index, or -1 if no column `name` presents.
+  int column_index(const std::string_view name) const noexcept
+  {
+    for (std::size_t i = 0; i < column_names_.size(); ++i) {
+      if (column_names_[i] == name)
+        return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  /**
+   * @returns The column index.
+   *
+   * @par Requires
+   * `name` presents.
+   */
+  int column_index_throw(const std::string_view name) const
+  {
+    const int index = column_index(name);
+    if (index < 0)
+      throw Exception{std::string{"result set has no column "}.append(name)};
+    return index;
+  }
+
+  /**
+   * @returns The fundamental SQLite type of the value (`SQLITE_INTEGER`,
+   * `SQLITE_FLOAT`, `SQLITE_TEXT`, `SQLITE_BLOB` or `SQLITE_NULL`).
+   *
+   * @par Requires
+   * `row < row_count() && column < column_count()`.
+   */
+  int type(const std::size_t row, const int column) const
+  {
+    return data_[cell__(row, column)];
+  }
+
+  /// @returns `type(row, column) == SQLITE_NULL`.
+  bool is_null(const std::size_t row, const int column) const
+  {
+    return type(row, column) == SQLITE_NULL;
+  }
+
+  /**
+   * @returns The value converted to type `T`.
+   *
+   * @details The supported types are: arithmetic types, `std::string`,
+   * `std::string_view`, `Text_utf8`, `Blob`, `std::vector<std::byte>` and
+   * `std::optional` of these. The conversions between the integers, reals and
+   * NULLs follow the SQLite rules: NULL is converted to zero or empty value,
+   * reals are truncated, the text is accessible as the blob and vice versa.
+   * Unlike SQLite, the text and blob values are not parsed as numbers, so
+   * such a conversion throws. The text and blob views (`std::string_view`,
+   * `Text_utf8` and `Blob`) remain valid until the result set is modified or
+   * destroyed.
+   *
+   * @par Requires
+   * `row < row_count() && column < column_count()`.
+   */
+  template<typename T>
+  T get(const std::size_t row, const int column) const
+  {
+    using U = std::decay_t<T>;
+    const std::size_t offset = cell__(row, column);
+    const int type = data_[offset];
+    const char* const value = data_.data() + offset + 1;
+    if constexpr (Is_optional<U>::value) {
+      if (type == SQLITE_NULL)
+        return std::nullopt;
+      else
+        return get<typename U::value_type>(row, column);
+    } else if constexpr (std::is_same_v<U, bool> || std::is_integral_v<U> ||
+      std::is_floating_point_v<U>) {
+      if (type == SQLITE_INTEGER)
+        return static_cast<U>(read__<sqlite3_int64>(value));
+      else if (type == SQLITE_FLOAT)
+        return static_cast<U>(read__<double>(value));
+      else if (type == SQLITE_NULL)
+        return U{};
+      else
+        throw Exception{"cannot convert text or blob value of result set to "
+          "number"};
+    } else {
+      std::string_view bytes;
+      if (type == SQLITE_TEXT || type == SQLITE_BLOB)
+        bytes = {value + sizeof(std::uint64_t),
+          static_cast<std::size_t>(read__<std::uint64_t>(value))};
+      else if (type != SQLITE_NULL)
+        throw Exception{"cannot convert numeric value of result set to text "
+          "or blob"};
+
+      if constexpr (std::is_same_v<U, std::string_view>)
+        return bytes;
+      else if constexpr (std::is_same_v<U, std::string>)
+        return std::string{bytes};
+      else if constexpr (std::is_same_v<U, Text_utf8>) {
+        if (type == SQLITE_BLOB)
+          throw Exception{"cannot convert blob value of result set to "
+            "Text_utf8"};
+        return Text_utf8{type == SQLITE_TEXT ? bytes.data() : "", bytes.size()};
+      } else if constexpr (std::is_same_v<U, Blob>)
+        return Blob{bytes.data(), bytes.size()};
+      else if constexpr (std::is_same_v<U, std::vector<std::byte>>) {
+        const auto* const b = reinterpret_cast<const std::byte*>(bytes.data());
+        return std::vector<std::byte>(b, b + bytes.size());
+      } else
+        static_assert(Is_optional<U>::value, "unsupported type of result set "
+          "value");
+    }
+  }
+
+  /// @overload
+  template<typename T>
+  T get(const std::size_t row, const std::string_view column) const
+  {
+    return get<T>(row, column_index_throw(column));
+  }
+
+  /// @returns The size of the data buffer in bytes.
+  std::size_t size_bytes() const noexcept
+  {
+    return data_.size() + offsets_.size() * sizeof(std::size_t);
+  }
+
+  /**
+   * @brief Reserves the memory for `row_count` rows with `byte_count` bytes of
+   * values in total.
+   *
+   * @details Each value takes 9 bytes plus the size of the text (with the
+   * terminating zero) or the blob. If the columns are not known yet, the
+   * memory for the rows is reserved once they become known.
+   */
+  void reserve(const std::size_t row_count, const std::size_t byte_count)
+  {
+    data_.reserve(byte_count);
+    if (column_names_.empty())
+      reserved_row_count_ = row_count;
+    else
+      offsets_.reserve(row_count * column_names_.size());
+  }
+
+  /// Releases the unused capacity of the buffers.
+  void shrink_to_fit()
+  {
+    data_.shrink_to_fit();
+    offsets_.shrink_to_fit();
+  }
+
+  /// Removes all the rows and the column names.
+  void clear() noexcept
+  {
+    column_names_.clear();
+    offsets_.clear();
+    data_.clear();
+    reserved_row_count_ = 0;
+  }
+
+  /// Swaps this instance with `rhs`.
+  void swap(Result_set& rhs) noexcept
+  {
+    using std::swap;
+    swap(column_names_, rhs.column_names_);
+    swap(offsets_, rhs.offsets_);
+    swap(data_, rhs.data_);
+    swap(reserved_row_count_, rhs.reserved_row_count_);
+  }
+
+private:
+  template<typename>
+  struct Is_optional final : std::false_type {};
+
+  template<typename T>
+  struct Is_optional<std::optional<T>> final : std::true_type {};
+
+  std::vector<std::string> column_names_;
+  std::vector<std::size_t> offsets_;
+  std::vector<char> data_;
+  std::size_t reserved_row_count_{};
+
+  void set_columns__(const Statement& statement)
+  {
+    sqlite3_stmt* const handle = statement.handle();
+    if (!handle)
+      throw Exception{"cannot get columns of invalid SQLite statement for "
+        "result set"};
+
+    const int count = sqlite3_column_count(handle);
+    column_names_.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i)
+      column_names_.emplace_back(statement.column_name(i));
+    if (reserved_row_count_) {
+      offsets_.reserve(reserved_row_count_ * column_names_.size());
+      reserved_row_count_ = 0;
+    }
+  }
+
+  std::size_t cell__(const std::size_t row, const int column) const
+  {
+    if (!(row < row_count() && 0 <= column && column < column_count()))
+      throw Exception{"cannot get value of result set using invalid row or "
+        "column index"};
+    return offsets_[row * column_names_.size() + static_cast<std::size_t>(column)];
+  }
+
+  template<typename T>
+  void append_bytes__(const T value)
+  {
+    const auto* const bytes = reinterpret_cast<const char*>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+  }
+
+  template<typename T>
+  static T read__(const char* const bytes) noexcept
+  {
+    T result;
+    std::memcpy(&result, bytes, sizeof(T));
+    return result;
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_RESULT_SET_HPP
@@ -17,12 +17,24 @@
 #ifndef DMITIGR_SQLIXX_SQLIXX_HPP
 #define DMITIGR_SQLIXX_SQLIXX_HPP
 
+#include "blob_store.hpp"
+#include "bulk_load.hpp"
+#include "capture.hpp"
 #include "connection.hpp"
+#include "connection_factory.hpp"
+#include "connection_options.hpp"
 #include "conversions.hpp"
 #include "data.hpp"
 #include "errctg.hpp"
 #include "exceptions.hpp"
+#include "file_ingestion.hpp"
+#include "keyset_cursor.hpp"
+#include "lob_store.hpp"
+#include "migration_runner.hpp"
+#include "read_only_connection.hpp"
+#include "result_set.hpp"
 #include "statement.hpp"
+#include "statement_catalog.hpp"
 #include "version.hpp"
 
 #endif  // DMITIGR_SQLIXX_SQLIXX_HPP
@@ -17,6 +17,7 @@
 #ifndef DMITIGR_SQLIXX_STATEMENT_HPP
 #define DMITIGR_SQLIXX_STATEMENT_HPP
 
+#include "capture.hpp"
 #include "conversions.hpp"
 #include "../base/assert.hpp"
 
@@ -25,18 +26,33 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
+#include <memory>
 #include <new>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <utility>
+#include <variant>
+#include <vector>
 
 namespace dmitigr::sqlixx {
 
+class Connection;
 class Statement;
 
 namespace detail {
+/// @returns The `identifier` quoted to be spliced into SQL.
+inline std::string quoted_identifier(const std::string_view identifier)
+{
+  std::string result{"\""};
+  for (const char ch : identifier)
+    result.append(ch == '"' ? 2 : 1, ch);
+  return result += '"';
+}
+
 template<typename F, typename = void>
 struct Execute_callback_traits final {
   constexpr static bool is_valid = false;
@@ -61,6 +77,92 @@ struct Execute_callback_traits<F,
     std::is_invocable_r_v<bool, F, const Statement&, int> || is_result_void;
   constexpr static bool has_error_parameter = true;
 };
+
+template<typename T>
+struct Is_bind_ownable final : std::bool_constant<
+  std::is_same_v<T, std::string> ||
+  std::is_same_v<T, std::vector<std::byte>>> {};
+
+template<typename T>
+struct Is_bind_ownable_optional final : std::false_type {};
+
+template<typename T>
+struct Is_bind_ownable_optional<std::optional<T>> final
+  : std::bool_constant<Is_bind_ownable<T>::value> {};
+
+template<typename T>
+struct Is_optional final : std::false_type {};
+
+template<typename T>
+struct Is_optional<std::optional<T>> final : std::true_type {};
+
+/// The last bound value of a parameter for the bind elision.
+struct Bound_value final {
+  enum class Kind : unsigned char { unknown, null, integer, real, view };
+  Kind kind{};
+  std::int64_t integer{}; // the value, the bits of double, or the view type
+  const void* data{};
+  std::uint64_t size{};
+
+  bool is_known() const noexcept
+  {
+    return kind != Kind::unknown;
+  }
+
+  bool operator==(const Bound_value& rhs) const noexcept
+  {
+    return kind == rhs.kind && integer == rhs.integer &&
+      data == rhs.data && size == rhs.size;
+  }
+};
+
+/**
+ * @returns The bound value of `value` for the bind elision. The views are
+ * identified by the pointer and size, which is correct only for the views
+ * bound with `SQLITE_STATIC` since SQLite reads such data upon each step.
+ * Therefore, the values bound with `SQLITE_TRANSIENT` or by move are unknown.
+ *
+ * @tparam T The type of the forwarding reference to `value`.
+ */
+template<typename T>
+Bound_value bound_value(const std::decay_t<T>& value) noexcept
+{
+  using U = std::decay_t<T>;
+  using Kind = Bound_value::Kind;
+  constexpr bool is_lvalue = std::is_lvalue_reference_v<T>;
+  if constexpr (std::is_same_v<U, int> || std::is_same_v<U, sqlite3_int64>) {
+    return {Kind::integer, value, nullptr, 0};
+  } else if constexpr (std::is_same_v<U, double>) {
+    std::int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return {Kind::real, bits, nullptr, 0};
+  } else if constexpr (std::is_same_v<U, std::string> ||
+    std::is_same_v<U, std::string_view>) {
+    if constexpr (is_lvalue)
+      return {Kind::view, SQLITE_TEXT, value.data(), value.size()};
+    else
+      return {};
+  } else if constexpr (Is_data<U>::value) {
+    if (is_lvalue || !value.is_data_owner())
+      return {Kind::view, U::Encoding, value.data(), value.size()};
+    else
+      return {};
+  } else if constexpr (Is_blob_sequence<U>::value) {
+    const auto size = value.size() * sizeof(*value.data());
+    if constexpr (is_lvalue)
+      return {Kind::view, SQLITE_BLOB, value.data(), size};
+    else if constexpr (Is_span<U>::value) {
+      if (!value.is_data_owner())
+        return {Kind::view, SQLITE_BLOB, value.data(), size};
+    }
+    return {};
+  } else if constexpr (Is_optional<U>::value) {
+    using V = std::conditional_t<is_lvalue,
+      const typename U::value_type&, typename U::value_type&&>;
+    return value ? bound_value<V>(*value) : Bound_value{Kind::null};
+  } else
+    return {};
+}
 } // namespace detail
 
 /// A prepared statement.
@@ -126,6 +228,11 @@ public:
     using std::swap;
     swap(last_step_result_, other.last_step_result_);
     swap(handle_, other.handle_);
+    swap(capture_, other.capture_);
+    swap(capture_id_, other.capture_id_);
+    swap(owned_, other.owned_);
+    swap(is_bind_elision_enabled_, other.is_bind_elision_enabled_);
+    swap(bound_, other.bound_);
   }
 
   /// @returns The underlying handle.
@@ -140,9 +247,28 @@ public:
     return handle_;
   }
 
-  /// @returns The released handle.
+  /**
+   * @returns The result of the last `sqlite3_step()` called by `execute()`,
+   * or `-1` if the statement is not executed since the last reset.
+   */
+  int last_step_result() const noexcept
+  {
+    return last_step_result_;
+  }
+
+  /**
+   * @returns The released handle.
+   *
+   * @remarks Since the values bound by move are owned by this instance, all the
+   * parameters are bound with NULL before the release if there are such values.
+   */
   sqlite3_stmt* release() noexcept
   {
+    if (owned_) {
+      sqlite3_clear_bindings(handle_);
+      owned_.reset();
+    }
+    bound_.reset();
     auto* const result = handle_;
     last_step_result_ = -1;
     handle_ = {};
@@ -156,9 +282,13 @@ public:
    */
   int close()
   {
+    if (capture_ && handle_)
+      capture_->finalize(capture_id_);
     const int result = sqlite3_finalize(handle_);
     last_step_result_ = -1;
     handle_ = {};
+    owned_.reset();
+    bound_.reset();
     return result;
   }
 
@@ -243,7 +373,15 @@ public:
       throw Exception{"cannot bind NULL to parameters of invalid SQLite "
         "statement"};
 
+    if (capture_)
+      capture_->clear_bindings(capture_id_);
     detail::check_bind(handle_, sqlite3_clear_bindings(handle_));
+    owned_.reset();
+    if (bound_) {
+      const auto count = static_cast<std::size_t>(parameter_count());
+      for (std::size_t i = 0; i < count; ++i)
+        bound_[i] = {detail::Bound_value::Kind::null};
+    }
   }
 
   /**
@@ -261,7 +399,16 @@ public:
       throw Exception{"cannot bind NULL to a parameter of SQLite statement "
         "using invalid index"};
 
+    const detail::Bound_value null{detail::Bound_value::Kind::null};
+    if (is_bind_elision_enabled_ && bound_value__(index) == null)
+      return;
+
+    if (capture_)
+      capture_->bind_null(capture_id_, index + 1);
     detail::check_bind(handle_, sqlite3_bind_null(handle_, index + 1));
+    release_owned__(index);
+    if (is_bind_elision_enabled_)
+      bound_value__(index) = null;
   }
 
   /// @overload
@@ -287,8 +434,13 @@ public:
       throw Exception{"cannot bind a text to a parameter of SQLite statement "
         "using invalid index"};
 
+    if (capture_)
+      capture_->bind(capture_id_, index + 1, value);
+    if (is_bind_elision_enabled_)
+      bound_value__(index) = {};
     detail::check_bind(handle_,
       sqlite3_bind_text(handle_, index + 1, value, -1, SQLITE_STATIC));
+    release_owned__(index);
   }
 
   /// @overload
@@ -305,7 +457,10 @@ public:
    * assumed that the value is a constant and does not need to be copied. If this
    * parameter is `rvalue`, then it's assumed to be destructed after this function
    * returns, so SQLite is required to make a private copy of the value before
-   * return.
+   * return. The exception is `rvalue` of type `std::string` or
+   * `std::vector<std::byte>` (or `std::optional` of these types), which is moved
+   * into this instance and is bound without copying. Such a value is kept until
+   * the parameter is rebound, `bind_null()` is called or the statement is closed.
    *
    * @par Requires
    * `handle() && index < parameter_count()`.
@@ -320,8 +475,17 @@ public:
       throw Exception{"cannot bind a value to a parameter of SQLite statement "
         "using invalid index"};
 
-    using U = std::decay_t<T>;
-    Conversions<U>::bind(handle_, index + 1, std::forward<T>(value));
+    if (is_bind_elision_enabled_) {
+      const auto value_to_bind = detail::bound_value<T>(value);
+      auto& bound_value = bound_value__(index);
+      if (value_to_bind.is_known() && value_to_bind == bound_value)
+        return;
+
+      bound_value = {};
+      bind__(index, std::forward<T>(value));
+      bound_value = value_to_bind;
+    } else
+      bind__(index, std::forward<T>(value));
   }
 
   /// @overload
@@ -348,6 +512,34 @@ public:
       std::forward<Types>(values)...);
   }
 
+  /**
+   * @brief Enables or disables the bind elision.
+   *
+   * @details When the bind elision is enabled, the last bound value of each
+   * parameter is remembered, and binding of the same value is skipped. The
+   * values of type `int`, `sqlite3_int64` and `double` are compared by value,
+   * and the views (`std::string_view`, `Blob`, `Span` etc) bound with
+   * `SQLITE_STATIC` are compared by the pointer and the size. (Since SQLite
+   * reads such data upon each step, modifications of the data in place are
+   * visible without rebinding.) The values bound with `SQLITE_TRANSIENT` or
+   * by move are always rebound.
+   *
+   * @remarks The bind elision is useful with `execute()` which binds all the
+   * parameters upon each execution, when most of them are unchanged.
+   */
+  void set_bind_elision_enabled(const bool value)
+  {
+    is_bind_elision_enabled_ = value;
+    if (!value)
+      bound_.reset();
+  }
+
+  /// @returns `true` if the bind elision is enabled.
+  bool is_bind_elision_enabled() const noexcept
+  {
+    return is_bind_elision_enabled_;
+  }
+
   /// @}
 
   // ---------------------------------------------------------------------------
@@ -399,7 +591,10 @@ public:
 
     while (true) {
       using Traits = detail::Execute_callback_traits<F>;
-      switch (last_step_result_ = sqlite3_step(handle_)) {
+      last_step_result_ = sqlite3_step(handle_);
+      if (capture_)
+        capture_->step(capture_id_, last_step_result_);
+      switch (last_step_result_) {
       case SQLITE_ROW:
         if constexpr (!Traits::is_result_void) {
           if constexpr (!Traits::has_error_parameter) {
@@ -441,6 +636,8 @@ public:
   /// Resets the statement back to its initial state, ready to be executed.
   int reset()
   {
+    if (capture_)
+      capture_->reset(capture_id_);
     last_step_result_ = -1;
     return sqlite3_reset(handle_);
   }
@@ -557,8 +754,69 @@ public:
   /// @}
 
 private:
+  friend Connection;
+
   int last_step_result_{-1};
   sqlite3_stmt* handle_{};
+  std::shared_ptr<Capture_writer> capture_;
+  std::uint64_t capture_id_{};
+
+  /*
+   * The values bound by move, indexed by the parameter index. (The array is
+   * allocated upon the first such binding and is never resized, so the values
+   * are never relocated while bound with SQLITE_STATIC.)
+   */
+  using Owned = std::variant<std::monostate, std::string, std::vector<std::byte>>;
+  std::unique_ptr<Owned[]> owned_;
+
+  void release_owned__(const int index) noexcept
+  {
+    if (owned_)
+      owned_[static_cast<std::size_t>(index)] = std::monostate{};
+  }
+
+  bool is_bind_elision_enabled_{};
+  std::unique_ptr<detail::Bound_value[]> bound_;
+
+  detail::Bound_value& bound_value__(const int index)
+  {
+    DMITIGR_ASSERT(is_bind_elision_enabled_);
+    if (!bound_)
+      bound_.reset(new detail::Bound_value[
+          static_cast<std::size_t>(parameter_count())]);
+    return bound_[static_cast<std::size_t>(index)];
+  }
+
+  template<typename T>
+  void bind__(const int index, T&& value)
+  {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_rvalue_reference_v<T&&> &&
+      detail::Is_bind_ownable_optional<U>::value) {
+      if (value)
+        bind(index, std::move(*value));
+      else
+        bind_null(index);
+    } else {
+      if (capture_)
+        capture_->bind<U>(capture_id_, index + 1, value);
+      if constexpr (std::is_rvalue_reference_v<T&&> &&
+        detail::Is_bind_ownable<U>::value) {
+        // Check it here since the old owned value is destroyed before binding.
+        if (last_step_result_ >= 0 || sqlite3_stmt_busy(handle_))
+          throw Sqlite_exception{SQLITE_MISUSE, "cannot bind a value to a "
+            "parameter of SQLite statement which is not reset"};
+        if (!owned_)
+          owned_.reset(new Owned[static_cast<std::size_t>(parameter_count())]);
+        const auto& owned = owned_[static_cast<std::size_t>(index)]
+          .template emplace<U>(std::move(value));
+        Conversions<U>::bind(handle_, index + 1, owned);
+      } else {
+        Conversions<U>::bind(handle_, index + 1, std::forward<T>(value));
+        release_owned__(index);
+      }
+    }
+  }
 
   template<std::size_t ... I, typename ... Types>
   void bind_many__(std::index_sequence<I...>, Types&& ... values)
@@ -0,0 +1,116 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_STATEMENT_CATALOG_HPP
+#define DMITIGR_SQLIXX_STATEMENT_CATALOG_HPP
+
+#include "exceptions.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx {
+
+class Connection;
+
+/**
+ * @brief An immutable list of SQL statements identified by indexes.
+ *
+ * @details The catalog is intended to be shared between connections (for
+ * example, between connections of a pool). Each connection prepares the
+ * statements of the catalog lazily and caches them.
+ *
+ * @remarks The prepare counters are thread-safe.
+ *
+ * @see Connection::set_statement_catalog(), Connection::statement().
+ */
+class Statement_catalog final {
+public:
+  /// An entry of the catalog.
+  struct Entry final {
+    /// The SQL text.
+    std::string sql;
+
+    /// The flags to be passed to `sqlite3_prepare_v3()`.
+    unsigned int flags{};
+  };
+
+  /// The constructor.
+  explicit Statement_catalog(std::vector<Entry> entries)
+    : entries_{std::move(entries)}
+    , prepare_counts_{new std::atomic<std::uint64_t>[entries_.size()]}
+  {
+    for (std::size_t i = 0; i < entries_.size(); ++i)
+      prepare_counts_[i] = 0;
+  }
+
+  /// @returns The number of entries.
+  std::size_t size() const noexcept
+  {
+    return entries_.size();
+  }
+
+  /**
+   * @returns The entry by the `id`.
+   *
+   * @par Requires
+   * `id < size()`.
+   */
+  const Entry& entry(const std::size_t id) const
+  {
+    if (!(id < size()))
+      throw Exception{"cannot get SQLite statement catalog entry using "
+        "invalid identifier"};
+
+    return entries_[id];
+  }
+
+  /**
+   * @returns The number of times the statement identified by `id` has been
+   * prepared across all the connections which are using this catalog.
+   *
+   * @par Requires
+   * `id < size()`.
+   */
+  std::uint64_t prepare_count(const std::size_t id) const
+  {
+    if (!(id < size()))
+      throw Exception{"cannot get SQLite statement catalog prepare count using "
+        "invalid identifier"};
+
+    return prepare_counts_[id].load(std::memory_order_relaxed);
+  }
+
+private:
+  friend Connection;
+
+  std::vector<Entry> entries_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> prepare_counts_;
+
+  void count_prepare(const std::size_t id) const noexcept
+  {
+    prepare_counts_[id].fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+} // namespace dmitigr::sqlixx
+
+#endif  // DMITIGR_SQLIXX_STATEMENT_CATALOG_HPP
@@ -0,0 +1,240 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-advisor [options]
+//
+// Options:
+//   --database=PATH (the database to create on the disk to be tuned for,
+//     default: dmitigr_sqlixx_advisor.db in the temp directory)
+//   --iterations=N (the number of iterations of each workload, default: 20000)
+//   --repetitions=N (default: 3)
+//   --min-gain=F (the minimal relative gain to accept a value, default: .03)
+//   --unsafe (consider synchronous=off, which is not crash-safe)
+//
+// Runs the workload suite of sqlixx-benchmark.hpp plus a workload of small
+// transactions against the database on the target machine and disk with the
+// different values of page_size, journal_mode, synchronous, cache_size,
+// mmap_size and wal_autocheckpoint, and prints the recommended
+// Connection_options profile with the measured gains.
+//
+// Since the full cartesian product of the values is too large to measure, the
+// parameters are tuned one at a time in the order of their expected impact
+// (coordinate descent): each value is measured with the best values of the
+// previously tuned parameters, and is accepted only if it improves the score
+// by at least the minimal gain. The score is the geometric mean of speedups
+// of the workloads relative to the SQLite defaults.
+
+#include "sqlixx-benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace sqlixx = dmitigr::sqlixx;
+namespace test = sqlixx::test;
+
+struct Parameter final {
+  const char* name{};
+  bool is_string{};
+  std::vector<std::string> values;
+  void(*apply)(sqlixx::Connection_options&, const std::string&){};
+};
+
+std::vector<Parameter> parameters(const bool is_unsafe)
+{
+  using Options = sqlixx::Connection_options;
+  std::vector<std::string> synchronous{"full", "normal"};
+  if (is_unsafe)
+    synchronous.emplace_back("off");
+  return {
+    {"page_size", false, {"1024", "4096", "8192", "16384", "65536"},
+      [](Options& o, const std::string& v){ o.set_page_size(std::stoi(v)); }},
+    {"journal_mode", true, {"delete", "truncate", "wal"},
+      [](Options& o, const std::string& v){ o.set_journal_mode(v); }},
+    {"synchronous", true, std::move(synchronous),
+      [](Options& o, const std::string& v){ o.set_synchronous(v); }},
+    {"cache_size", false, {"-2000", "-8192", "-32768", "-131072"},
+      [](Options& o, const std::string& v){ o.set_cache_size(std::stoi(v)); }},
+    {"mmap_size", false, {"0", "67108864", "268435456", "1073741824"},
+      [](Options& o, const std::string& v){ o.set_mmap_size(std::stoll(v)); }},
+    {"wal_autocheckpoint", false, {"1000", "4000", "16000"},
+      [](Options& o, const std::string& v)
+      {
+        o.set_wal_autocheckpoint(std::stoi(v));
+      }}
+  };
+}
+
+// Small write transactions, which are sensitive to the journal mode and
+// synchronous level unlike the batched workloads of the suite.
+void small_transactions(sqlixx::Connection& conn, const int iterations)
+{
+  auto s = conn.prepare("update kv set n = n + 1 where k = ?");
+  for (int i = 0; i < iterations / 100; ++i)
+    s.execute(i);
+}
+
+void remove_database(const std::filesystem::path& path)
+{
+  for (const char* const suffix : {"", "-journal", "-wal", "-shm"})
+    std::filesystem::remove(path.string() + suffix);
+}
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// @returns The median seconds of each workload.
+std::vector<double> measure(const std::filesystem::path& path,
+  const sqlixx::Connection_options& options, const int iterations,
+  const int repetitions)
+{
+  const auto& suite = test::workloads();
+  std::vector<std::vector<double>> samples(suite.size() + 1);
+  for (int r = 0; r < repetitions; ++r) {
+    remove_database(path);
+    sqlixx::Connection conn{path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+      options};
+    test::create_workload_schema(conn);
+    for (std::size_t i = 0; i < suite.size(); ++i)
+      samples[i].push_back(test::measure_seconds([&]
+      {
+        suite[i].run(conn, iterations);
+      }));
+    samples.back().push_back(test::measure_seconds([&]
+    {
+      small_transactions(conn, iterations);
+    }));
+  }
+  remove_database(path);
+
+  std::vector<double> result;
+  for (auto& s : samples)
+    result.push_back(median(std::move(s)));
+  return result;
+}
+
+// @returns The geometric mean of speedups of `times` relative to `baseline`.
+double score(const std::vector<double>& baseline, const std::vector<double>& times)
+{
+  double log_sum{};
+  for (std::size_t i = 0; i < times.size(); ++i)
+    log_sum += std::log(baseline[i] / times[i]);
+  return std::exp(log_sum / static_cast<double>(times.size()));
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    std::map<std::string, std::string> args{
+      {"iterations", "20000"},
+      {"repetitions", "3"},
+      {"min-gain", ".03"},
+      {"database", (std::filesystem::temp_directory_path() /
+          "dmitigr_sqlixx_advisor.db").string()}};
+    bool is_unsafe{};
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      const auto eq = arg.find('=');
+      if (arg == "--unsafe")
+        is_unsafe = true;
+      else if (arg.compare(0, 2, "--") || eq == std::string::npos)
+        throw std::runtime_error{"invalid argument " + arg};
+      else
+        args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    const int iterations = std::stoi(args["iterations"]);
+    const int repetitions = std::stoi(args["repetitions"]);
+    const double min_gain = std::stod(args["min-gain"]);
+    const std::filesystem::path database{args["database"]};
+    if (iterations < 100 || repetitions <= 0)
+      throw std::runtime_error{"invalid number of iterations or repetitions"};
+
+    const auto& suite = test::workloads();
+    const auto baseline = measure(database, {}, iterations, repetitions);
+    std::printf("%-20s %-12s %8s\n", "parameter", "value", "speedup");
+    std::printf("%-20s %-12s %8.3f\n", "(sqlite defaults)", "", 1.);
+
+    sqlixx::Connection_options best;
+    double best_score{1};
+    std::vector<double> best_times{baseline};
+    std::vector<std::pair<const Parameter*, std::string>> chosen;
+    const auto params = parameters(is_unsafe);
+    for (const auto& param : params) {
+      if (!std::strcmp(param.name, "wal_autocheckpoint") &&
+        best.journal_mode() != "wal")
+        continue;
+
+      const std::string* best_value{};
+      auto param_best = best;
+      auto param_score = best_score;
+      auto param_times = best_times;
+      for (const auto& value : param.values) {
+        auto options = best;
+        param.apply(options, value);
+        const auto times = measure(database, options, iterations, repetitions);
+        const double s = score(baseline, times);
+        std::printf("%-20s %-12s %8.3f\n", param.name, value.c_str(), s);
+        if (s > param_score * (1 + min_gain)) {
+          best_value = &value;
+          param_best = options;
+          param_score = s;
+          param_times = times;
+        }
+      }
+      if (best_value) {
+        best = param_best;
+        best_score = param_score;
+        best_times = param_times;
+        chosen.emplace_back(&param, *best_value);
+      }
+    }
+
+    std::printf("\n%-20s %12s %12s %8s\n", "workload", "default,ms",
+      "tuned,ms", "speedup");
+    for (std::size_t i = 0; i < baseline.size(); ++i)
+      std::printf("%-20s %12.2f %12.2f %8.3f\n",
+        i < suite.size() ? suite[i].name : "small_transactions",
+        baseline[i] * 1000, best_times[i] * 1000, baseline[i] / best_times[i]);
+    std::printf("\nRecommended profile (%.1f%% faster than the defaults):\n\n",
+      (best_score - 1) * 100);
+    std::printf("  sqlixx::Connection_options{}");
+    for (const auto& [param, value] : chosen) {
+      if (param->is_string)
+        std::printf("\n    .set_%s(\"%s\")", param->name, value.c_str());
+      else
+        std::printf("\n    .set_%s(%s)", param->name, value.c_str());
+    }
+    std::printf(";\n");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
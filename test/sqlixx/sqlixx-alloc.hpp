@@ -0,0 +1,162 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Counting of heap allocations made by the global operator new and by SQLite.
+//
+// This header replaces the global allocation functions, so it must be
+// included into exactly one translation unit of an executable.
+
+#ifndef DMITIGR_SQLIXX_TEST_ALLOC_HPP
+#define DMITIGR_SQLIXX_TEST_ALLOC_HPP
+
+#include "../../src/base/assert.hpp"
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace dmitigr::sqlixx::test {
+
+/// The number of calls of the global operator new.
+inline std::atomic<std::uint64_t> new_count;
+
+/// The number of calls of `xMalloc` and `xRealloc` of SQLite.
+inline std::atomic<std::uint64_t> sqlite_malloc_count;
+
+/// The numbers of allocations.
+struct Alloc_counts final {
+  std::uint64_t new_count{};
+  std::uint64_t sqlite_malloc_count{};
+
+  std::uint64_t total() const noexcept
+  {
+    return new_count + sqlite_malloc_count;
+  }
+};
+
+/// @returns The current numbers of allocations.
+inline Alloc_counts alloc_counts() noexcept
+{
+  return {new_count.load(), sqlite_malloc_count.load()};
+}
+
+/// @returns The numbers of allocations made by `f`.
+template<typename F>
+Alloc_counts count_allocs(F&& f)
+{
+  const auto before = alloc_counts();
+  f();
+  const auto after = alloc_counts();
+  return {after.new_count - before.new_count,
+    after.sqlite_malloc_count - before.sqlite_malloc_count};
+}
+
+namespace detail {
+inline sqlite3_mem_methods sqlite_mem_methods;
+
+inline void* sqlite_malloc(const int size)
+{
+  sqlite_malloc_count.fetch_add(1, std::memory_order_relaxed);
+  return sqlite_mem_methods.xMalloc(size);
+}
+
+inline void* sqlite_realloc(void* const ptr, const int size)
+{
+  sqlite_malloc_count.fetch_add(1, std::memory_order_relaxed);
+  return sqlite_mem_methods.xRealloc(ptr, size);
+}
+} // namespace detail
+
+/**
+ * @brief Installs the counting memory allocator of SQLite.
+ *
+ * @par Requires
+ * Must be called before any use of SQLite.
+ */
+inline void install_sqlite_alloc_counter()
+{
+  DMITIGR_ASSERT(sqlite3_config(SQLITE_CONFIG_GETMALLOC,
+      &detail::sqlite_mem_methods) == SQLITE_OK);
+  auto methods = detail::sqlite_mem_methods;
+  methods.xMalloc = detail::sqlite_malloc;
+  methods.xRealloc = detail::sqlite_realloc;
+  DMITIGR_ASSERT(sqlite3_config(SQLITE_CONFIG_MALLOC, &methods) == SQLITE_OK);
+}
+
+} // namespace dmitigr::sqlixx::test
+
+void* operator new(const std::size_t size)
+{
+  dmitigr::sqlixx::test::new_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* const result = std::malloc(size ? size : 1))
+    return result;
+  throw std::bad_alloc{};
+}
+
+void* operator new[](const std::size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return operator new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept
+{
+  return operator new(size, std::nothrow);
+}
+
+// GCC warns on inlined std::free() of the pointers returned by the replaced
+// operator new, which is std::malloc() here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* const ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* const ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* const ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // DMITIGR_SQLIXX_TEST_ALLOC_HPP
@@ -0,0 +1,261 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-benchcmp <baseline.json> <current.json>
+//   [--threshold=F] [--mad-factor=F]
+//
+// Compares the benchmark results written by test::write_json() with the
+// baseline. For each benchmark of the baseline the medians of ns/op of both
+// runs are compared. The regression is reported if the current median
+// exceeds the baseline median by more than both the relative threshold
+// (0.25 by default) and the noise estimate, which is the specified factor
+// (3 by default) of the larger of the scaled median absolute deviations of
+// the runs. An increase of allocations/op is always a regression.
+//
+// Exits with 1 on regressions, or with 2 on errors.
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Benchmark final {
+  std::vector<double> ns_per_op;
+  double allocs_per_op{};
+};
+
+// A parser of the subset of JSON written by test::write_json().
+class Parser final {
+public:
+  explicit Parser(std::string input)
+    : input_{std::move(input)}
+  {}
+
+  std::map<std::string, Benchmark> parse()
+  {
+    std::map<std::string, Benchmark> result;
+    expect('{');
+    if (string() != "benchmarks")
+      throw std::runtime_error{"no benchmarks"};
+    expect(':');
+    expect('[');
+    if (!consume(']')) {
+      do {
+        std::string name;
+        Benchmark benchmark;
+        expect('{');
+        do {
+          const auto key = string();
+          expect(':');
+          if (key == "name") {
+            name = string();
+          } else if (key == "ns_per_op") {
+            expect('[');
+            if (!consume(']')) {
+              do {
+                benchmark.ns_per_op.push_back(number());
+              } while (consume(','));
+              expect(']');
+            }
+          } else if (key == "allocs_per_op") {
+            benchmark.allocs_per_op = number();
+          } else
+            skip_value();
+        } while (consume(','));
+        expect('}');
+        result[name] = std::move(benchmark);
+      } while (consume(','));
+      expect(']');
+    }
+    expect('}');
+    return result;
+  }
+
+private:
+  std::string input_;
+  std::string::size_type pos_{};
+
+  void skip_spaces()
+  {
+    while (pos_ < input_.size() &&
+      std::isspace(static_cast<unsigned char>(input_[pos_])))
+      ++pos_;
+  }
+
+  bool consume(const char c)
+  {
+    skip_spaces();
+    if (pos_ < input_.size() && input_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const char c)
+  {
+    if (!consume(c))
+      throw std::runtime_error{std::string{"expected "} + c + " at offset " +
+        std::to_string(pos_)};
+  }
+
+  std::string string()
+  {
+    expect('"');
+    std::string result;
+    while (pos_ < input_.size() && input_[pos_] != '"') {
+      if (input_[pos_] == '\\')
+        ++pos_;
+      if (pos_ < input_.size())
+        result += input_[pos_++];
+    }
+    expect('"');
+    return result;
+  }
+
+  double number()
+  {
+    skip_spaces();
+    const char* const begin = input_.c_str() + pos_;
+    char* end{};
+    const double result = std::strtod(begin, &end);
+    if (end == begin)
+      throw std::runtime_error{"expected number at offset " +
+        std::to_string(pos_)};
+    pos_ += static_cast<std::string::size_type>(end - begin);
+    return result;
+  }
+
+  void skip_value()
+  {
+    skip_spaces();
+    if (pos_ >= input_.size())
+      throw std::runtime_error{"unexpected end of input"};
+    else if (input_[pos_] == '"') {
+      string();
+    } else if (input_[pos_] == '{' || input_[pos_] == '[') {
+      const char close = input_[pos_] == '{' ? '}' : ']';
+      ++pos_;
+      if (!consume(close)) {
+        do {
+          if (close == '}') {
+            string();
+            expect(':');
+          }
+          skip_value();
+        } while (consume(','));
+        expect(close);
+      }
+    } else
+      number();
+  }
+};
+
+std::map<std::string, Benchmark> read(const char* const path)
+{
+  std::ifstream in{path};
+  if (!in)
+    throw std::runtime_error{std::string{"cannot open "} + path};
+  std::ostringstream content;
+  content << in.rdbuf();
+  return Parser{content.str()}.parse();
+}
+
+double median(std::vector<double> values)
+{
+  if (values.empty())
+    throw std::runtime_error{"no samples"};
+  std::sort(values.begin(), values.end());
+  const auto n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// @returns The median absolute deviation scaled to be a consistent estimator
+// of the standard deviation of the normal distribution.
+double mad(const std::vector<double>& values, const double med)
+{
+  std::vector<double> deviations;
+  for (const double v : values)
+    deviations.push_back(std::abs(v - med));
+  return 1.4826 * median(std::move(deviations));
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    if (argc < 3)
+      throw std::runtime_error{std::string{"usage: "} + argv[0] +
+        " <baseline.json> <current.json> [--threshold=F] [--mad-factor=F]"};
+    double threshold{.25};
+    double mad_factor{3};
+    for (int i = 3; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      if (!arg.compare(0, 12, "--threshold="))
+        threshold = std::stod(arg.substr(12));
+      else if (!arg.compare(0, 13, "--mad-factor="))
+        mad_factor = std::stod(arg.substr(13));
+      else
+        throw std::runtime_error{"invalid argument " + arg};
+    }
+
+    const auto baseline = read(argv[1]);
+    const auto current = read(argv[2]);
+    int regressions{};
+    std::printf("%-24s %12s %12s %8s %10s %10s  %s\n", "benchmark",
+      "base,ns", "curr,ns", "delta", "base,a/op", "curr,a/op", "verdict");
+    for (const auto& [name, base] : baseline) {
+      const auto i = current.find(name);
+      if (i == current.cend()) {
+        std::printf("%-24s %12s\n", name.c_str(), "missing");
+        ++regressions;
+        continue;
+      }
+      const auto& curr = i->second;
+      const double base_med = median(base.ns_per_op);
+      const double curr_med = median(curr.ns_per_op);
+      const double noise = mad_factor * std::max(mad(base.ns_per_op, base_med),
+        mad(curr.ns_per_op, curr_med));
+      const double diff = curr_med - base_med;
+      const bool is_slower = diff > threshold * base_med && diff > noise;
+      const bool is_faster = -diff > threshold * base_med && -diff > noise;
+      const bool is_allocating = curr.allocs_per_op > base.allocs_per_op + 1e-6;
+      const char* const verdict = is_allocating ? "REGRESSION (allocations)" :
+        is_slower ? "REGRESSION" : is_faster ? "improvement" : "ok";
+      if (is_slower || is_allocating)
+        ++regressions;
+      std::printf("%-24s %12.1f %12.1f %+7.1f%% %10.4f %10.4f  %s\n",
+        name.c_str(), base_med, curr_med, 100 * diff / base_med,
+        base.allocs_per_op, curr.allocs_per_op, verdict);
+    }
+    return regressions ? 1 : 0;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,240 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_SQLIXX_TEST_BENCHMARK_HPP
+#define DMITIGR_SQLIXX_TEST_BENCHMARK_HPP
+
+#include "../../src/sqlixx/sqlixx.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::sqlixx::test {
+
+/// A workload of the suite.
+struct Workload final {
+  /// The name of the workload.
+  const char* name{};
+
+  /// The workload itself. The second argument is a number of iterations.
+  void(*run)(Connection&, int){};
+};
+
+/// Creates the schema required by the workload suite.
+inline void create_workload_schema(Connection& conn)
+{
+  conn.execute("drop table if exists kv");
+  conn.execute("drop table if exists wide");
+  conn.execute("create table kv(k integer primary key, v text, n real)");
+
+  std::string sql{"create table wide(id integer primary key"};
+  for (int i = 0; i < 32; ++i)
+    sql.append(", c").append(std::to_string(i)).append(" text");
+  sql.append(")");
+  conn.execute(sql);
+}
+
+/// @returns The workload suite.
+inline const std::vector<Workload>& workloads()
+{
+  static const std::vector<Workload> result{
+    {"insert", [](Connection& conn, const int iterations)
+    {
+      const std::string value(100, 'v');
+      auto s = conn.prepare("insert or replace into kv(k, v, n) values(?, ?, ?)");
+      conn.execute("begin");
+      for (int i = 0; i < iterations; ++i)
+        s.execute(i, std::string_view{value}, i * .5);
+      conn.execute("commit");
+    }},
+    {"point_select", [](Connection& conn, const int iterations)
+    {
+      auto s = conn.prepare("select v, n from kv where k = ?");
+      for (int i = 0; i < iterations; ++i)
+        s.execute([](const Statement& s)
+        {
+          return !s.result<std::string_view>(0).empty();
+        }, i);
+    }},
+    {"range_scan", [](Connection& conn, const int iterations)
+    {
+      auto s = conn.prepare("select k, v from kv where k >= ? order by k limit 50");
+      for (int i = 0; i < iterations / 50; ++i)
+        s.execute([](const Statement&){}, i * 50);
+    }},
+    {"update", [](Connection& conn, const int iterations)
+    {
+      auto s = conn.prepare("update kv set n = n + 1 where k = ?");
+      conn.execute("begin");
+      for (int i = 0; i < iterations; ++i)
+        s.execute(i);
+      conn.execute("commit");
+    }},
+    {"wide_insert", [](Connection& conn, const int iterations)
+    {
+      std::string sql{"insert or replace into wide values(?"};
+      for (int i = 0; i < 32; ++i)
+        sql.append(", ?");
+      sql.append(")");
+      auto s = conn.prepare(sql);
+      const std::string_view value{"wide column value"};
+      conn.execute("begin");
+      for (int i = 0; i < iterations / 10; ++i) {
+        s.reset();
+        s.bind(0, i);
+        for (int j = 1; j <= 32; ++j)
+          s.bind(j, value);
+        s.execute();
+      }
+      conn.execute("commit");
+    }},
+    {"wide_select", [](Connection& conn, const int iterations)
+    {
+      auto s = conn.prepare("select * from wide where id >= ? "
+        "order by c0, c31 limit 100");
+      for (int i = 0; i < iterations / 100; ++i)
+        s.execute([](const Statement& s)
+        {
+          for (int j = 1; j <= 32; ++j)
+            static_cast<void>(s.result<std::string_view>(j));
+        }, i);
+    }}
+  };
+  return result;
+}
+
+/// @returns The duration of `f` call in seconds.
+template<typename F>
+double measure_seconds(F&& f)
+{
+  namespace chrono = std::chrono;
+  const auto start = chrono::steady_clock::now();
+  f();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/// Latency statistics in microseconds.
+struct Latency_stats final {
+  std::size_t count{};
+  double p50{};
+  double p90{};
+  double p99{};
+  double p999{};
+  double max{};
+};
+
+/// @returns The statistics of latency `samples` specified in nanoseconds.
+inline Latency_stats latency_stats(std::vector<std::uint64_t> samples)
+{
+  Latency_stats result;
+  if (samples.empty())
+    return result;
+
+  std::sort(samples.begin(), samples.end());
+  const auto percentile = [&samples](const double p)
+  {
+    const auto i = static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1));
+    return static_cast<double>(samples[i]) / 1000;
+  };
+  result.count = samples.size();
+  result.p50 = percentile(.5);
+  result.p90 = percentile(.9);
+  result.p99 = percentile(.99);
+  result.p999 = percentile(.999);
+  result.max = static_cast<double>(samples.back()) / 1000;
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// Machine-readable results
+// -----------------------------------------------------------------------------
+
+/// A result of a benchmark.
+struct Result final {
+  /// The name of the benchmark.
+  std::string name;
+
+  /// The nanoseconds per operation of each repetition.
+  std::vector<double> ns_per_op;
+
+  /// The number of heap allocations per operation.
+  double allocs_per_op{};
+
+  /// The additional metrics.
+  std::vector<std::pair<std::string, double>> metrics;
+};
+
+/**
+ * @brief Writes the `results` as JSON to `out`.
+ *
+ * @details The format is:
+ * @code{json}
+ * {"benchmarks": [{"name": "...", "ns_per_op": [...], "allocs_per_op": 0,
+ *   "metrics": {"...": 0}}]}
+ * @endcode
+ */
+inline void write_json(std::ostream& out, const std::vector<Result>& results)
+{
+  const auto quoted = [](const std::string& str)
+  {
+    std::string result{"\""};
+    for (const char c : str) {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+    return result += '"';
+  };
+
+  const auto old_precision = out.precision(17);
+  out << "{\"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    out << (i ? ",\n  " : "\n  ")
+        << "{\"name\": " << quoted(r.name) << ", \"ns_per_op\": [";
+    for (std::size_t j = 0; j < r.ns_per_op.size(); ++j)
+      out << (j ? ", " : "") << r.ns_per_op[j];
+    out << "], \"allocs_per_op\": " << r.allocs_per_op << ", \"metrics\": {";
+    for (std::size_t j = 0; j < r.metrics.size(); ++j)
+      out << (j ? ", " : "") << quoted(r.metrics[j].first) << ": "
+          << r.metrics[j].second;
+    out << "}}";
+  }
+  out << "\n]}\n";
+  out.precision(old_precision);
+}
+
+/// Writes the `results` as JSON to the file at `path`.
+inline void write_json(const std::string& path,
+  const std::vector<Result>& results)
+{
+  std::ofstream out{path, std::ios_base::trunc};
+  write_json(out, results);
+  if (!out)
+    throw std::runtime_error{"cannot write " + path};
+}
+
+} // namespace dmitigr::sqlixx::test
+
+#endif  // DMITIGR_SQLIXX_TEST_BENCHMARK_HPP
@@ -0,0 +1,278 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-benchmark_concurrency [options]
+//
+// Options:
+//   --readers=N (the maximum number of reader threads, default: 8)
+//   --writers=M (the maximum number of writer threads, default: 2)
+//   --seconds=F (the duration of each configuration, default: 0.5)
+//   --records=N (default: 100000)
+//   --database=PATH (default: dmitigr_sqlixx_concurrency.db in the temp
+//     directory)
+//   --json=PATH (write the results as JSON to PATH)
+//
+// Sweeps 1, 2, 4, ... N reader threads and 0, 1, 2, ... M writer threads
+// against one database in WAL mode, with a shared connection or a connection
+// per thread, with SQLITE_OPEN_NOMUTEX or SQLITE_OPEN_FULLMUTEX, and with
+// the different synchronous levels. (The shared connection is only used with
+// SQLITE_OPEN_FULLMUTEX since it's unsafe otherwise.) Also, the readers are
+// run with Read_only_connection per thread (which is opened in immutable mode
+// if there are no writers, and always with SQLITE_OPEN_NOMUTEX, so the writers
+// are only run with SQLITE_OPEN_NOMUTEX as well in such a case, and the
+// synchronous levels are only swept if there are writers). Reports the
+// throughput, the number of busy retries and the latency percentiles.
+
+#include "sqlixx-benchmark.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace chrono = std::chrono;
+namespace sqlixx = dmitigr::sqlixx;
+namespace test = sqlixx::test;
+
+int busy_handler(void* const data, const int count)
+{
+  static_cast<std::atomic<std::uint64_t>*>(data)->fetch_add(1,
+    std::memory_order_relaxed);
+  if (count > 20000)
+    return 0;
+  std::this_thread::sleep_for(chrono::microseconds{50});
+  return 1;
+}
+
+enum class Connection_kind { private_, shared, read_only };
+constexpr const char* connection_kind_names[] = {"private", "shared",
+  "readonly"};
+
+struct Config final {
+  Connection_kind kind{};
+  bool is_fullmutex{};
+  const char* synchronous{};
+  int readers{};
+  int writers{};
+};
+
+struct Outcome final {
+  std::uint64_t reads{};
+  std::uint64_t writes{};
+  std::uint64_t busy_retries{};
+  std::uint64_t errors{};
+  test::Latency_stats read_latency;
+  test::Latency_stats write_latency;
+};
+
+Outcome run(const std::filesystem::path& database, const Config& config,
+  const std::uint64_t records, const double seconds)
+{
+  const int flags = SQLITE_OPEN_READWRITE |
+    (config.is_fullmutex ? SQLITE_OPEN_FULLMUTEX : SQLITE_OPEN_NOMUTEX);
+  const auto options = sqlixx::Connection_options{}
+    .set_synchronous(config.synchronous);
+  std::atomic<std::uint64_t> busy_retries{};
+  std::atomic<std::uint64_t> errors{};
+  const auto open = [&]
+  {
+    auto result = std::make_unique<sqlixx::Connection>(database, flags,
+      options);
+    sqlite3_busy_handler(result->handle(), busy_handler, &busy_retries);
+    return result;
+  };
+
+  const bool is_shared = config.kind == Connection_kind::shared;
+  const bool is_read_only = config.kind == Connection_kind::read_only;
+  const int threads = config.readers + config.writers;
+  std::vector<std::unique_ptr<sqlixx::Connection>> connections;
+  std::vector<sqlixx::Read_only_connection> read_only_connections;
+  for (int i = 0; i < (is_shared ? 1 : threads); ++i) {
+    if (is_read_only && i < config.readers) {
+      read_only_connections.emplace_back(database, sqlixx::Connection_options{},
+        !config.writers);
+      sqlite3_busy_handler(read_only_connections.back().handle(), busy_handler,
+        &busy_retries);
+      connections.emplace_back();
+    } else
+      connections.push_back(open());
+  }
+
+  std::atomic_bool is_running{true};
+  std::vector<std::vector<std::uint64_t>> latencies(
+    static_cast<std::size_t>(threads));
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]
+    {
+      const bool is_writer = t >= config.readers;
+      const auto i = is_shared ? 0 : static_cast<std::size_t>(t);
+      auto stmt = is_writer ?
+        connections[i]->prepare("update kv set n = n + 1 where k = ?") :
+        is_read_only ?
+        read_only_connections[i].prepare("select v, n from kv where k = ?") :
+        connections[i]->prepare("select v, n from kv where k = ?");
+      std::mt19937_64 gen{static_cast<std::uint64_t>(t) + 1};
+      std::uniform_int_distribution<std::uint64_t> keys{0, records - 1};
+      auto& samples = latencies[static_cast<std::size_t>(t)];
+      while (is_running.load(std::memory_order_relaxed)) {
+        const auto start = chrono::steady_clock::now();
+        try {
+          stmt.execute([](const sqlixx::Statement&){},
+            static_cast<sqlite3_int64>(keys(gen)));
+        } catch (const std::exception&) {
+          stmt.reset();
+          errors.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        samples.push_back(static_cast<std::uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(
+              chrono::steady_clock::now() - start).count()));
+      }
+    });
+  }
+  std::this_thread::sleep_for(chrono::duration<double>{seconds});
+  is_running = false;
+  for (auto& worker : workers)
+    worker.join();
+
+  Outcome result;
+  std::vector<std::uint64_t> reads;
+  std::vector<std::uint64_t> writes;
+  for (int t = 0; t < threads; ++t) {
+    auto& dst = t < config.readers ? reads : writes;
+    const auto& src = latencies[static_cast<std::size_t>(t)];
+    dst.insert(dst.end(), src.begin(), src.end());
+  }
+  result.reads = reads.size();
+  result.writes = writes.size();
+  result.busy_retries = busy_retries;
+  result.errors = errors;
+  result.read_latency = test::latency_stats(std::move(reads));
+  result.write_latency = test::latency_stats(std::move(writes));
+  return result;
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    std::map<std::string, std::string> args{
+      {"readers", "8"},
+      {"writers", "2"},
+      {"seconds", "0.5"},
+      {"records", "100000"},
+      {"database", (std::filesystem::temp_directory_path() /
+          "dmitigr_sqlixx_concurrency.db").string()}};
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      const auto eq = arg.find('=');
+      if (arg.compare(0, 2, "--") || eq == std::string::npos)
+        throw std::runtime_error{"invalid argument " + arg};
+      args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    const int max_readers = std::stoi(args["readers"]);
+    const int max_writers = std::stoi(args["writers"]);
+    const double seconds = std::stod(args["seconds"]);
+    const auto records = std::stoull(args["records"]);
+    const std::filesystem::path database{args["database"]};
+    if (max_readers < 1 || max_writers < 0 || !records)
+      throw std::runtime_error{"invalid number of readers, writers or records"};
+
+    // Prepare the database.
+    std::filesystem::remove(database);
+    std::filesystem::remove(database.string() + "-wal");
+    std::filesystem::remove(database.string() + "-shm");
+    {
+      sqlixx::Connection conn{database,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        sqlixx::Connection_options{}.set_journal_mode("wal")};
+      conn.execute("create table kv(k integer primary key, v text, n integer)");
+      auto insert = conn.prepare("insert into kv values(?, ?, 0)");
+      const std::string value(100, 'v');
+      conn.execute("begin");
+      for (std::uint64_t i = 0; i < records; ++i)
+        insert.execute(static_cast<sqlite3_int64>(i), std::string_view{value});
+      conn.execute("commit");
+    }
+
+    std::vector<test::Result> results;
+    std::printf("%-8s %-9s %-6s %4s %4s %11s %11s %9s %6s %9s %9s %9s %9s\n",
+      "conn", "mutex", "sync", "rd", "wr", "reads/s", "writes/s", "busy",
+      "errors", "rd50,us", "rd99,us", "wr50,us", "wr99,us");
+    for (const auto kind : {Connection_kind::private_, Connection_kind::shared,
+        Connection_kind::read_only}) {
+      for (const bool is_fullmutex : {false, true}) {
+        if ((kind == Connection_kind::shared && !is_fullmutex) ||
+          (kind == Connection_kind::read_only && is_fullmutex))
+          continue;
+        for (const char* const sync : {"off", "normal", "full"}) {
+          for (int readers = 1; readers <= max_readers; readers *= 2) {
+            for (int writers = 0; writers <= max_writers; ++writers) {
+              // The synchronous level doesn't affect the read-only readers.
+              const bool is_sync_sweepable =
+                kind != Connection_kind::read_only || writers;
+              if (!is_sync_sweepable && std::strcmp(sync, "off"))
+                continue;
+              const char* const sync_name = is_sync_sweepable ? sync : "-";
+              const Config config{kind, is_fullmutex, sync, readers, writers};
+              const auto o = run(database, config, records, seconds);
+              const char* const conn =
+                connection_kind_names[static_cast<int>(kind)];
+              const char* const mutex = is_fullmutex ? "fullmutex" : "nomutex";
+              std::printf("%-8s %-9s %-6s %4d %4d %11.0f %11.0f %9llu %6llu "
+                "%9.1f %9.1f %9.1f %9.1f\n", conn, mutex, sync_name, readers,
+                writers, static_cast<double>(o.reads) / seconds,
+                static_cast<double>(o.writes) / seconds,
+                static_cast<unsigned long long>(o.busy_retries),
+                static_cast<unsigned long long>(o.errors),
+                o.read_latency.p50, o.read_latency.p99,
+                o.write_latency.p50, o.write_latency.p99);
+              results.push_back({std::string{"concurrency/"}.append(conn)
+                .append("/").append(mutex).append("/").append(sync_name)
+                .append("/r").append(std::to_string(readers))
+                .append("w").append(std::to_string(writers)),
+                {o.read_latency.p50 * 1000}, 0,
+                {{"reads_per_sec", static_cast<double>(o.reads) / seconds},
+                 {"writes_per_sec", static_cast<double>(o.writes) / seconds},
+                 {"busy_retries", static_cast<double>(o.busy_retries)},
+                 {"read_p99_us", o.read_latency.p99},
+                 {"read_p999_us", o.read_latency.p999},
+                 {"write_p99_us", o.write_latency.p99},
+                 {"write_p999_us", o.write_latency.p999}}});
+            }
+          }
+        }
+      }
+    }
+    if (const auto i = args.find("json"); i != args.end())
+      test::write_json(i->second, results);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
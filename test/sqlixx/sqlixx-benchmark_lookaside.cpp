@@ -0,0 +1,82 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-benchmark_lookaside [iterations [json]]
+//
+// Sweeps the lookaside configurations over the workload suite. The results
+// are written as JSON to the file at path `json` if specified.
+
+#include "sqlixx-benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+int main(const int argc, char* const argv[])
+{
+  namespace sqlixx = dmitigr::sqlixx;
+  namespace test = sqlixx::test;
+
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+  if (iterations <= 0) {
+    std::cerr << "invalid number of iterations" << std::endl;
+    return 1;
+  }
+
+  if (sqlite3_compileoption_used("OMIT_LOOKASIDE"))
+    std::cerr << "warning: SQLite is compiled with SQLITE_OMIT_LOOKASIDE, "
+      "the counters will be zero" << std::endl;
+
+  const int slot_sizes[] = {0, 64, 128, 256, 512, 1200, 2048};
+  const int slot_counts[] = {50, 128, 500, 2000};
+
+  std::vector<test::Result> results;
+  std::printf("%-10s %-6s %-13s %10s %10s %10s %10s\n",
+    "slot_size", "count", "workload", "seconds", "hit",
+    "miss_size", "miss_full");
+  for (const int size : slot_sizes) {
+    for (const int count : slot_counts) {
+      if (!size && count != slot_counts[0])
+        continue; // lookaside is disabled, the count doesn't matter
+
+      sqlixx::Connection conn{":memory:",
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        sqlixx::Connection_options{}.set_lookaside(
+          sqlixx::Lookaside_config{size, size ? count : 0, nullptr})};
+      test::create_workload_schema(conn);
+      static_cast<void>(conn.lookaside_status(true));
+
+      for (const auto& workload : test::workloads()) {
+        const double seconds = test::measure_seconds([&]
+        {
+          workload.run(conn, iterations);
+        });
+        const auto status = conn.lookaside_status(true);
+        std::printf("%-10d %-6d %-13s %10.4f %10d %10d %10d\n",
+          size, size ? count : 0, workload.name, seconds,
+          status.hit, status.miss_size, status.miss_full);
+        results.push_back({std::string{"lookaside/"}
+          .append(std::to_string(size)).append("x")
+          .append(std::to_string(size ? count : 0)).append("/")
+          .append(workload.name), {seconds * 1e9 / iterations}, 0,
+          {{"hit", status.hit}, {"miss_size", status.miss_size},
+           {"miss_full", status.miss_full}}});
+      }
+    }
+  }
+  if (argc > 2)
+    test::write_json(argv[2], results);
+}
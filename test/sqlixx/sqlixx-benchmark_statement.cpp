@@ -0,0 +1,220 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-benchmark_statement [--iterations=N]
+//   [--repetitions=N] [--json=PATH]
+//
+// Measures the core bind, step and result paths of Statement. Each benchmark
+// is repeated the specified number of times to let dmitigr_sqlixx-benchcmp to
+// compare the results with the baseline (sqlixx-benchmark_statement.json)
+// in a noise-aware manner. The baseline is hardware-specific and should be
+// regenerated with --json on the reference machine after intended changes.
+
+#include "sqlixx-alloc.hpp"
+#include "sqlixx-benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(const int argc, char* const argv[])
+{
+  namespace sqlixx = dmitigr::sqlixx;
+  namespace test = sqlixx::test;
+
+  try {
+    int iterations{200000};
+    int repetitions{7};
+    std::string json;
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      if (!arg.compare(0, 13, "--iterations="))
+        iterations = std::stoi(arg.substr(13));
+      else if (!arg.compare(0, 14, "--repetitions="))
+        repetitions = std::stoi(arg.substr(14));
+      else if (!arg.compare(0, 7, "--json="))
+        json = arg.substr(7);
+      else
+        throw std::runtime_error{"invalid argument " + arg};
+    }
+    if (iterations <= 0 || repetitions <= 0)
+      throw std::runtime_error{"invalid number of iterations or repetitions"};
+
+    test::install_sqlite_alloc_counter();
+    // The lookaside memory is big enough for all the statements below to step
+    // without allocations. SQLite compiled without the lookaside memory
+    // allocator allocates VDBE cursors from the heap upon stepping anyway, so
+    // only the allocations of sqlixx are counted in such a case.
+    const bool is_step_allocation_free =
+      !sqlite3_compileoption_used("OMIT_LOOKASIDE");
+    sqlixx::Connection conn{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY,
+      sqlixx::Connection_options{}.set_lookaside(
+        sqlixx::Lookaside_config{1200, 1000, nullptr})};
+    conn.execute("create table t(i integer primary key, r real, t text, b blob)");
+    conn.execute("insert into t values(1, 1.5, 'text value', x'0102030405')");
+
+    auto bind_stmt = conn.prepare("select ?, ?, ?, ?");
+    auto select_stmt = conn.prepare("select i, r, t, b from t where i = ?");
+    auto insert_stmt = conn.prepare("insert or replace into t values(?, ?, ?, ?)");
+    select_stmt.execute([](const sqlixx::Statement&){ return false; }, 1);
+    auto params_stmt = conn.prepare("select ?1, ?2, ?3, ?4");
+    auto elided_params_stmt = conn.prepare("select ?1, ?2, ?3, ?4");
+    elided_params_stmt.set_bind_elision_enabled(true);
+
+    const std::string_view text{"text value"};
+    const char blob_data[] = {1, 2, 3, 4, 5};
+    const sqlixx::Blob blob{blob_data, sizeof(blob_data)};
+    long long sink{};
+
+    struct Case final {
+      const char* name;
+      void(*run)(void*);
+    };
+    // Lambdas below capture nothing to keep the indirection cheap. The state
+    // is passed via the pointer to the local structure.
+    struct State final {
+      sqlixx::Statement* bind_stmt;
+      sqlixx::Statement* select_stmt;
+      sqlixx::Statement* insert_stmt;
+      sqlixx::Statement* params_stmt;
+      sqlixx::Statement* elided_params_stmt;
+      const std::string_view* text;
+      const sqlixx::Blob* blob;
+      long long* sink;
+    } state{&bind_stmt, &select_stmt, &insert_stmt, &params_stmt,
+      &elided_params_stmt, &text, &blob, &sink};
+
+    const Case cases[] = {
+      {"bind_int", [](void* const p)
+      {
+        static_cast<State*>(p)->bind_stmt->bind(0, 42);
+      }},
+      {"bind_double", [](void* const p)
+      {
+        static_cast<State*>(p)->bind_stmt->bind(1, 4.2);
+      }},
+      {"bind_string_view", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->bind_stmt->bind(2, *s->text);
+      }},
+      {"bind_blob", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->bind_stmt->bind(3, *s->blob);
+      }},
+      {"execute_point_select", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->select_stmt->execute([s](const sqlixx::Statement& st)
+        {
+          *s->sink += st.result<int>(0);
+        }, 1);
+      }},
+      {"result_int", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->select_stmt->reset();
+        s->select_stmt->execute([s](const sqlixx::Statement& st)
+        {
+          for (int i = 0; i < 16; ++i)
+            *s->sink += st.result<int>(0);
+          return false;
+        }, 1);
+      }},
+      {"result_string_view", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->select_stmt->reset();
+        s->select_stmt->execute([s](const sqlixx::Statement& st)
+        {
+          for (int i = 0; i < 16; ++i)
+            *s->sink += static_cast<long long>(
+              st.result<std::string_view>(2).size());
+          return false;
+        }, 1);
+      }},
+      {"result_blob", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->select_stmt->reset();
+        s->select_stmt->execute([s](const sqlixx::Statement& st)
+        {
+          for (int i = 0; i < 16; ++i)
+            *s->sink += static_cast<long long>(
+              st.result<sqlixx::Blob>(3).size());
+          return false;
+        }, 1);
+      }},
+      {"execute_insert", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->insert_stmt->execute(2, 2.5, *s->text, *s->blob);
+      }},
+      {"execute_4_params", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->params_stmt->execute(*s->text, 42, *s->blob,
+          static_cast<int>(++*s->sink));
+      }},
+      {"execute_4_params_elided", [](void* const p)
+      {
+        auto* const s = static_cast<State*>(p);
+        s->elided_params_stmt->execute(*s->text, 42, *s->blob,
+          static_cast<int>(++*s->sink));
+      }}
+    };
+
+    std::vector<test::Result> results;
+    std::printf("%-22s %12s %12s %14s\n", "benchmark", "median,ns",
+      "min,ns", "allocs/op");
+    for (const auto& c : cases) {
+      test::Result result{c.name, {}, 0, {}};
+      c.run(&state); // warm up: the first execution of a statement may allocate
+      for (int r = 0; r < repetitions; ++r) {
+        test::Alloc_counts allocs;
+        const double seconds = test::measure_seconds([&]
+        {
+          allocs = test::count_allocs([&]
+          {
+            for (int i = 0; i < iterations; ++i)
+              c.run(&state);
+          });
+        });
+        result.ns_per_op.push_back(seconds * 1e9 / iterations);
+        result.allocs_per_op = std::max(result.allocs_per_op,
+          static_cast<double>(is_step_allocation_free ?
+            allocs.total() : allocs.new_count) / iterations);
+      }
+      auto sorted = result.ns_per_op;
+      std::sort(sorted.begin(), sorted.end());
+      std::printf("%-22s %12.1f %12.1f %14.4f\n", c.name,
+        sorted[sorted.size() / 2], sorted.front(), result.allocs_per_op);
+      results.push_back(std::move(result));
+    }
+    if (!json.empty())
+      test::write_json(json, results);
+    const volatile long long result_sink{sink}; // prevent the optimization
+    static_cast<void>(result_sink);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
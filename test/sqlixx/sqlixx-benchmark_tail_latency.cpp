@@ -0,0 +1,225 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-benchmark_tail_latency [options]
+//
+// Options:
+//   --readers=N (default: 2)
+//   --writers=N (default: 1)
+//   --seconds=F (the duration of each run, default: 2)
+//   --records=N (default: 10000)
+//   --read-us=N (the mean latency of reads, default: 100)
+//   --write-us=N (the mean latency of writes, default: 50)
+//   --sync-us=N (the mean latency of syncs, default: 1000)
+//   --stall-probability=F (the probability of the sync stall, default: .01)
+//   --stall-ms=N (the duration of the sync stall, default: 50)
+//   --short-read-probability=F (default: .01)
+//   --journal-mode=MODE (default: wal)
+//   --synchronous=LEVEL (default: full)
+//   --busy-timeout-ms=N (default: 5000)
+//   --database=PATH (default: dmitigr_sqlixx_tail_latency.db in the temp
+//     directory)
+//   --json=PATH (write the results as JSON to PATH)
+//
+// Runs the readers (point selects) and the writers (autocommit updates)
+// against the database opened via test::Latency_vfs first without and then
+// with the injected latency, and reports the latency percentiles including
+// p999. The page cache is kept small to make reads reach the VFS.
+
+#include "sqlixx-benchmark.hpp"
+#include "sqlixx-latency_vfs.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace chrono = std::chrono;
+namespace sqlixx = dmitigr::sqlixx;
+namespace test = sqlixx::test;
+
+struct Outcome final {
+  test::Latency_stats read;
+  test::Latency_stats write;
+  std::uint64_t errors{};
+};
+
+Outcome run(const std::string& uri, const sqlixx::Connection_options& options,
+  const int readers, const int writers, const std::uint64_t records,
+  const double seconds)
+{
+  const int threads = readers + writers;
+  std::atomic_bool is_running{true};
+  std::atomic<std::uint64_t> errors{};
+  std::vector<std::vector<std::uint64_t>> latencies(static_cast<std::size_t>(threads));
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]
+    {
+      sqlixx::Connection conn{uri, SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI |
+        SQLITE_OPEN_NOMUTEX, options};
+      auto stmt = conn.prepare(t >= readers ?
+        "update kv set n = n + 1 where k = ?" :
+        "select v, n from kv where k = ?");
+      std::mt19937_64 gen{static_cast<std::uint64_t>(t) + 1};
+      std::uniform_int_distribution<std::uint64_t> keys{0, records - 1};
+      auto& samples = latencies[static_cast<std::size_t>(t)];
+      while (is_running.load(std::memory_order_relaxed)) {
+        const auto start = chrono::steady_clock::now();
+        try {
+          stmt.execute([](const sqlixx::Statement&){},
+            static_cast<sqlite3_int64>(keys(gen)));
+        } catch (const std::exception&) {
+          stmt.reset();
+          errors.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        samples.push_back(static_cast<std::uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(
+              chrono::steady_clock::now() - start).count()));
+      }
+    });
+  }
+  std::this_thread::sleep_for(chrono::duration<double>{seconds});
+  is_running = false;
+  for (auto& worker : workers)
+    worker.join();
+
+  std::vector<std::uint64_t> reads;
+  std::vector<std::uint64_t> writes;
+  for (int t = 0; t < threads; ++t) {
+    auto& dst = t < readers ? reads : writes;
+    const auto& src = latencies[static_cast<std::size_t>(t)];
+    dst.insert(dst.end(), src.begin(), src.end());
+  }
+  return {test::latency_stats(std::move(reads)),
+    test::latency_stats(std::move(writes)), errors};
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    std::map<std::string, std::string> args{
+      {"readers", "2"},
+      {"writers", "1"},
+      {"seconds", "2"},
+      {"records", "10000"},
+      {"read-us", "100"},
+      {"write-us", "50"},
+      {"sync-us", "1000"},
+      {"stall-probability", ".01"},
+      {"stall-ms", "50"},
+      {"short-read-probability", ".01"},
+      {"journal-mode", "wal"},
+      {"synchronous", "full"},
+      {"busy-timeout-ms", "5000"},
+      {"database", (std::filesystem::temp_directory_path() /
+          "dmitigr_sqlixx_tail_latency.db").string()}};
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      const auto eq = arg.find('=');
+      if (arg.compare(0, 2, "--") || eq == std::string::npos)
+        throw std::runtime_error{"invalid argument " + arg};
+      args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    const int readers = std::stoi(args["readers"]);
+    const int writers = std::stoi(args["writers"]);
+    const double seconds = std::stod(args["seconds"]);
+    const auto records = std::stoull(args["records"]);
+    const std::filesystem::path database{args["database"]};
+    if (readers < 0 || writers < 0 || readers + writers == 0 || !records)
+      throw std::runtime_error{"invalid number of readers, writers or records"};
+
+    using chrono::microseconds;
+    test::Latency_profile profile;
+    profile.read.jitter = microseconds{std::stoll(args["read-us"])};
+    profile.write.jitter = microseconds{std::stoll(args["write-us"])};
+    profile.sync.jitter = microseconds{std::stoll(args["sync-us"])};
+    profile.sync.tail_probability = std::stod(args["stall-probability"]);
+    profile.sync.tail = chrono::milliseconds{std::stoll(args["stall-ms"])};
+    profile.short_read_probability = std::stod(args["short-read-probability"]);
+
+    test::Latency_vfs vfs{"dmitigr_sqlixx_latency"};
+    const std::string uri{"file:" + database.string() + "?vfs=" + vfs.name()};
+    const auto options = sqlixx::Connection_options{}
+      .set_journal_mode(args["journal-mode"])
+      .set_synchronous(args["synchronous"])
+      .set_cache_size(-64)
+      .set_busy_timeout(chrono::milliseconds{std::stoll(args["busy-timeout-ms"])});
+
+    // Prepare the database.
+    for (const char* const suffix : {"", "-journal", "-wal", "-shm"})
+      std::filesystem::remove(database.string() + suffix);
+    {
+      sqlixx::Connection conn{uri, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
+        SQLITE_OPEN_URI, options};
+      conn.execute("create table kv(k integer primary key, v text, n integer)");
+      auto insert = conn.prepare("insert into kv values(?, ?, 0)");
+      const std::string value(100, 'v');
+      conn.execute("begin");
+      for (std::uint64_t i = 0; i < records; ++i)
+        insert.execute(static_cast<sqlite3_int64>(i), std::string_view{value});
+      conn.execute("commit");
+    }
+
+    std::vector<test::Result> results;
+    std::printf("%-9s %-5s %9s %9s %9s %9s %9s %9s %7s\n", "profile", "op",
+      "count", "p50,us", "p90,us", "p99,us", "p999,us", "max,us", "errors");
+    for (const bool is_injected : {false, true}) {
+      vfs.set_profile(is_injected ? profile : test::Latency_profile{});
+      vfs.reset_stats();
+      const auto o = run(uri, options, readers, writers, records, seconds);
+      const char* const name = is_injected ? "injected" : "baseline";
+      for (const auto& [op, stats] : {std::pair{"read", o.read},
+          std::pair{"write", o.write}}) {
+        std::printf("%-9s %-5s %9zu %9.1f %9.1f %9.1f %9.1f %9.1f %7llu\n",
+          name, op, stats.count, stats.p50, stats.p90, stats.p99, stats.p999,
+          stats.max, static_cast<unsigned long long>(o.errors));
+        results.push_back({std::string{"tail_latency/"}.append(name)
+          .append("/").append(op), {stats.p50 * 1000}, 0,
+          {{"p90_us", stats.p90}, {"p99_us", stats.p99},
+           {"p999_us", stats.p999}, {"max_us", stats.max},
+           {"count", static_cast<double>(stats.count)}}});
+      }
+      if (is_injected) {
+        const auto s = vfs.stats();
+        std::printf("\ninjected: %llu reads (%llu short), %llu writes, "
+          "%llu syncs, %llu stalls, %.1f ms in total\n",
+          static_cast<unsigned long long>(s.reads),
+          static_cast<unsigned long long>(s.short_reads),
+          static_cast<unsigned long long>(s.writes),
+          static_cast<unsigned long long>(s.syncs),
+          static_cast<unsigned long long>(s.tails),
+          static_cast<double>(s.injected.count()) / 1e6);
+      }
+    }
+    if (const auto i = args.find("json"); i != args.end())
+      test::write_json(i->second, results);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
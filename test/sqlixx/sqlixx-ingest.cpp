@@ -0,0 +1,110 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-ingest [options]
+//
+// Options:
+//   --root=PATH (the directory of the files to ingest, default:
+//     dmitigr_sqlixx_ingest in the temp directory)
+//   --database=PATH (default: dmitigr_sqlixx_ingest.db in the temp directory)
+//   --extension=EXT (the extension of the files to ingest, default: .bin)
+//   --readers=N (the number of reader threads, default: the number of
+//     hardware threads minus one)
+//   --queue=N (the capacity of the queue of files read, default: 256)
+//   --batch=N (the number of files per transaction, default: 10000)
+//   --generate=N (generate N files in the root directory before ingestion)
+//   --size=N (the size of each file generated in bytes, default: 4096)
+//
+// Ingests the files of the root directory tree into the table
+// files(path text primary key, data blob) by using sqlixx::ingest_files() and
+// reports the throughput.
+
+#include "../../src/sqlixx/sqlixx.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+int main(const int argc, char* const argv[])
+{
+  namespace fs = std::filesystem;
+  namespace sqlixx = dmitigr::sqlixx;
+
+  try {
+    sqlixx::File_ingestion_options options;
+    std::map<std::string, std::string> args{
+      {"root", (fs::temp_directory_path() / "dmitigr_sqlixx_ingest").string()},
+      {"database", (fs::temp_directory_path() /
+          "dmitigr_sqlixx_ingest.db").string()},
+      {"extension", ".bin"},
+      {"readers", std::to_string(options.reader_count)},
+      {"queue", std::to_string(options.queue_capacity)},
+      {"batch", std::to_string(options.batch_size)},
+      {"generate", "0"},
+      {"size", "4096"}};
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      const auto eq = arg.find('=');
+      if (arg.compare(0, 2, "--") || eq == std::string::npos)
+        throw std::runtime_error{"invalid argument " + arg};
+      args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    const fs::path root{args["root"]};
+    const fs::path database{args["database"]};
+    options.extension = args["extension"];
+    options.reader_count = static_cast<unsigned>(std::stoul(args["readers"]));
+    options.queue_capacity = std::stoull(args["queue"]);
+    options.batch_size = std::stoull(args["batch"]);
+    const auto generate = std::stoull(args["generate"]);
+    const auto size = std::stoull(args["size"]);
+
+    if (generate) {
+      fs::create_directories(root);
+      const std::string content(size, 'x');
+      for (unsigned long long i = 0; i < generate; ++i) {
+        // Spread the files across subdirectories of 1000 files each.
+        const auto dir = root / std::to_string(i / 1000);
+        if (!(i % 1000))
+          fs::create_directories(dir);
+        auto path = dir / std::to_string(i);
+        path += options.extension;
+        std::ofstream{path, std::ios_base::binary} << content;
+      }
+    }
+
+    fs::remove(database);
+    fs::remove(database.string() + "-wal");
+    fs::remove(database.string() + "-shm");
+    sqlixx::Connection conn{database, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+      sqlixx::Connection_options{}
+        .set_journal_mode("wal")
+        .set_synchronous("normal")};
+    conn.execute("create table files(path text primary key, data blob)");
+    auto insert = conn.prepare("insert into files(path, data) values(?, ?)");
+    const auto stats = sqlixx::ingest_files(conn, insert, root, options);
+    std::printf("%llu files, %.1f MB in %.3f s: %.0f files/s, %.1f MB/s\n",
+      static_cast<unsigned long long>(stats.file_count),
+      static_cast<double>(stats.byte_count) / 1048576, stats.seconds,
+      stats.files_per_second(), stats.megabytes_per_second());
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
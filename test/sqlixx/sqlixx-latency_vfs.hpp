@@ -0,0 +1,470 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The VFS shim injecting the latency into I/O of the underlying VFS to
+// reproduce the slow disk behavior in the benchmarks and tests.
+
+#ifndef DMITIGR_SQLIXX_TEST_LATENCY_VFS_HPP
+#define DMITIGR_SQLIXX_TEST_LATENCY_VFS_HPP
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace dmitigr::sqlixx::test {
+
+/**
+ * @brief A distribution of the injected latency.
+ *
+ * @details The latency of an operation is `base` plus the exponentially
+ * distributed value with the mean `jitter`, plus `tail` with the probability
+ * `tail_probability` (e.g. to model the fsync stalls).
+ */
+struct Latency_distribution final {
+  std::chrono::microseconds base{};
+  std::chrono::microseconds jitter{};
+  double tail_probability{};
+  std::chrono::microseconds tail{};
+};
+
+/// A profile of the injected latency.
+struct Latency_profile final {
+  /**
+   * The bitwise OR of `SQLITE_OPEN_MAIN_DB`, `SQLITE_OPEN_MAIN_JOURNAL`,
+   * `SQLITE_OPEN_WAL`, `SQLITE_OPEN_TEMP_DB` etc. denoting the types of files
+   * the latency is injected into.
+   */
+  int file_types{SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL};
+
+  /// The latency of `xRead`.
+  Latency_distribution read;
+
+  /// The latency of `xWrite`.
+  Latency_distribution write;
+
+  /// The latency of `xSync`.
+  Latency_distribution sync;
+
+  /**
+   * The probability of the short read. The short read is modeled as the OS
+   * does it: the read is performed in two parts, each of which is delayed
+   * according to `read`. (The SQLite's notion of the short read, which is
+   * `SQLITE_IOERR_SHORT_READ`, means the end of file and cannot be injected
+   * without corrupting the data.)
+   */
+  double short_read_probability{};
+};
+
+/// The counters of the injected events.
+struct Latency_vfs_stats final {
+  std::uint64_t reads{};
+  std::uint64_t writes{};
+  std::uint64_t syncs{};
+  std::uint64_t tails{};
+  std::uint64_t short_reads{};
+  std::chrono::nanoseconds injected{};
+};
+
+/**
+ * @brief The VFS shim injecting the latency into I/O of the underlying VFS.
+ *
+ * @details The VFS is registered upon construction and unregistered upon
+ * destruction. To use it, open the database by URI with the `vfs` parameter,
+ * e.g. `file:test.db?vfs=latency` with `SQLITE_OPEN_URI`.
+ *
+ * @par Thread safety
+ * The instance can be used by several connections concurrently. The profile
+ * must not be changed while the VFS is in use.
+ */
+class Latency_vfs final {
+public:
+  /// The destructor. Unregisters the VFS.
+  ~Latency_vfs()
+  {
+    sqlite3_vfs_unregister(&vfs_);
+  }
+
+  /**
+   * @brief Registers the VFS `name` on top of the VFS `base` (or the default
+   * one if `nullptr`).
+   *
+   * @par Requires
+   * No VFS named `name` must be registered.
+   */
+  explicit Latency_vfs(std::string name, Latency_profile profile = {},
+    const char* const base = nullptr, const std::uint64_t seed = 1)
+    : name_{std::move(name)}
+    , profile_{profile}
+    , base_{sqlite3_vfs_find(base)}
+    , random_{seed}
+  {
+    if (!base_)
+      throw std::invalid_argument{"no base VFS found"};
+    else if (sqlite3_vfs_find(name_.c_str()))
+      throw std::invalid_argument{"VFS " + name_ + " is already registered"};
+
+    vfs_.iVersion = std::min(base_->iVersion, 3);
+    vfs_.szOsFile = static_cast<int>(sizeof(File)) + base_->szOsFile;
+    vfs_.mxPathname = base_->mxPathname;
+    vfs_.zName = name_.c_str();
+    vfs_.pAppData = this;
+    vfs_.xOpen = open;
+    vfs_.xDelete = [](sqlite3_vfs* const v, const char* const p, const int s)
+    {
+      return self(v)->base_->xDelete(self(v)->base_, p, s);
+    };
+    vfs_.xAccess = [](sqlite3_vfs* const v, const char* const p, const int f,
+      int* const r)
+    {
+      return self(v)->base_->xAccess(self(v)->base_, p, f, r);
+    };
+    vfs_.xFullPathname = [](sqlite3_vfs* const v, const char* const p,
+      const int n, char* const r)
+    {
+      return self(v)->base_->xFullPathname(self(v)->base_, p, n, r);
+    };
+    vfs_.xDlOpen = [](sqlite3_vfs* const v, const char* const p)
+    {
+      return self(v)->base_->xDlOpen(self(v)->base_, p);
+    };
+    vfs_.xDlError = [](sqlite3_vfs* const v, const int n, char* const m)
+    {
+      self(v)->base_->xDlError(self(v)->base_, n, m);
+    };
+    vfs_.xDlSym = [](sqlite3_vfs* const v, void* const h, const char* const s)
+    {
+      return self(v)->base_->xDlSym(self(v)->base_, h, s);
+    };
+    vfs_.xDlClose = [](sqlite3_vfs* const v, void* const h)
+    {
+      self(v)->base_->xDlClose(self(v)->base_, h);
+    };
+    vfs_.xRandomness = [](sqlite3_vfs* const v, const int n, char* const o)
+    {
+      return self(v)->base_->xRandomness(self(v)->base_, n, o);
+    };
+    vfs_.xSleep = [](sqlite3_vfs* const v, const int m)
+    {
+      return self(v)->base_->xSleep(self(v)->base_, m);
+    };
+    vfs_.xCurrentTime = [](sqlite3_vfs* const v, double* const r)
+    {
+      return self(v)->base_->xCurrentTime(self(v)->base_, r);
+    };
+    vfs_.xGetLastError = [](sqlite3_vfs* const v, const int n, char* const m)
+    {
+      return self(v)->base_->xGetLastError(self(v)->base_, n, m);
+    };
+    if (vfs_.iVersion >= 2)
+      vfs_.xCurrentTimeInt64 = [](sqlite3_vfs* const v, sqlite3_int64* const r)
+      {
+        return self(v)->base_->xCurrentTimeInt64(self(v)->base_, r);
+      };
+    if (vfs_.iVersion >= 3) {
+      vfs_.xSetSystemCall = [](sqlite3_vfs* const v, const char* const n,
+        const sqlite3_syscall_ptr p)
+      {
+        return self(v)->base_->xSetSystemCall(self(v)->base_, n, p);
+      };
+      vfs_.xGetSystemCall = [](sqlite3_vfs* const v, const char* const n)
+      {
+        return self(v)->base_->xGetSystemCall(self(v)->base_, n);
+      };
+      vfs_.xNextSystemCall = [](sqlite3_vfs* const v, const char* const n)
+      {
+        return self(v)->base_->xNextSystemCall(self(v)->base_, n);
+      };
+    }
+
+    if (const int r = sqlite3_vfs_register(&vfs_, false); r != SQLITE_OK)
+      throw std::runtime_error{"cannot register VFS " + name_};
+  }
+
+  /// Non copy-constructible.
+  Latency_vfs(const Latency_vfs&) = delete;
+
+  /// Non copy-assignable.
+  Latency_vfs& operator=(const Latency_vfs&) = delete;
+
+  /// Non move-constructible.
+  Latency_vfs(Latency_vfs&&) = delete;
+
+  /// Non move-assignable.
+  Latency_vfs& operator=(Latency_vfs&&) = delete;
+
+  /// @returns The name of the VFS.
+  const std::string& name() const noexcept
+  {
+    return name_;
+  }
+
+  /// @returns The profile.
+  const Latency_profile& profile() const noexcept
+  {
+    return profile_;
+  }
+
+  /**
+   * @brief Sets the profile.
+   *
+   * @par Requires
+   * The VFS must not be in use.
+   */
+  void set_profile(const Latency_profile& profile) noexcept
+  {
+    profile_ = profile;
+  }
+
+  /// @returns The counters of the injected events.
+  Latency_vfs_stats stats() const noexcept
+  {
+    return {reads_.load(), writes_.load(), syncs_.load(), tails_.load(),
+      short_reads_.load(), std::chrono::nanoseconds{injected_ns_.load()}};
+  }
+
+  /// Resets the counters of the injected events.
+  void reset_stats() noexcept
+  {
+    reads_ = writes_ = syncs_ = tails_ = short_reads_ = injected_ns_ = 0;
+  }
+
+private:
+  struct File final {
+    sqlite3_file base;
+    sqlite3_io_methods methods;
+    Latency_vfs* vfs;
+    bool is_injected;
+
+    sqlite3_file* real() noexcept
+    {
+      return reinterpret_cast<sqlite3_file*>(this + 1);
+    }
+  };
+
+  std::string name_;
+  Latency_profile profile_;
+  sqlite3_vfs* base_{};
+  sqlite3_vfs vfs_{};
+  std::mutex random_mutex_;
+  std::mt19937_64 random_;
+  std::atomic<std::uint64_t> reads_{};
+  std::atomic<std::uint64_t> writes_{};
+  std::atomic<std::uint64_t> syncs_{};
+  std::atomic<std::uint64_t> tails_{};
+  std::atomic<std::uint64_t> short_reads_{};
+  std::atomic<std::int64_t> injected_ns_{};
+
+  static Latency_vfs* self(sqlite3_vfs* const vfs) noexcept
+  {
+    return static_cast<Latency_vfs*>(vfs->pAppData);
+  }
+
+  static File* file(sqlite3_file* const f) noexcept
+  {
+    return reinterpret_cast<File*>(f);
+  }
+
+  bool chance(const double probability)
+  {
+    if (probability <= 0)
+      return false;
+    const std::lock_guard lg{random_mutex_};
+    return std::uniform_real_distribution<double>{}(random_) < probability;
+  }
+
+  void delay(const Latency_distribution& dist)
+  {
+    namespace chrono = std::chrono;
+    chrono::nanoseconds value{dist.base};
+    if (dist.jitter.count() > 0) {
+      const std::lock_guard lg{random_mutex_};
+      value += chrono::duration_cast<chrono::nanoseconds>(
+        chrono::duration<double, std::micro>{
+          std::exponential_distribution<double>{
+            1. / static_cast<double>(dist.jitter.count())}(random_)});
+    }
+    if (chance(dist.tail_probability)) {
+      value += dist.tail;
+      tails_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (value.count() > 0) {
+      std::this_thread::sleep_for(value);
+      injected_ns_.fetch_add(value.count(), std::memory_order_relaxed);
+    }
+  }
+
+  static int open(sqlite3_vfs* const v, const char* const name,
+    sqlite3_file* const f, const int flags, int* const out_flags)
+  {
+    auto* const vfs = self(v);
+    auto* const fl = file(f);
+    fl->base.pMethods = nullptr;
+    fl->vfs = vfs;
+    fl->is_injected = flags & vfs->profile_.file_types;
+    auto* const real = fl->real();
+    const int r = vfs->base_->xOpen(vfs->base_, name, real, flags, out_flags);
+    if (!real->pMethods)
+      return r;
+
+    auto& m = fl->methods;
+    m = sqlite3_io_methods{};
+    m.iVersion = std::min(real->pMethods->iVersion, 3);
+    m.xClose = [](sqlite3_file* const f)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xClose(real);
+    };
+    m.xRead = [](sqlite3_file* const f, void* const data, const int size,
+      const sqlite3_int64 offset)
+    {
+      auto* const fl = file(f);
+      auto* const real = fl->real();
+      auto* const vfs = fl->vfs;
+      if (!fl->is_injected)
+        return real->pMethods->xRead(real, data, size, offset);
+
+      vfs->reads_.fetch_add(1, std::memory_order_relaxed);
+      if (size > 1 && vfs->chance(vfs->profile_.short_read_probability)) {
+        vfs->short_reads_.fetch_add(1, std::memory_order_relaxed);
+        const int head = size / 2;
+        vfs->delay(vfs->profile_.read);
+        if (const int r = real->pMethods->xRead(real, data, head, offset);
+          r != SQLITE_OK)
+          return r == SQLITE_IOERR_SHORT_READ ?
+            real->pMethods->xRead(real, data, size, offset) : r;
+        vfs->delay(vfs->profile_.read);
+        return real->pMethods->xRead(real, static_cast<char*>(data) + head,
+          size - head, offset + head);
+      }
+      vfs->delay(vfs->profile_.read);
+      return real->pMethods->xRead(real, data, size, offset);
+    };
+    m.xWrite = [](sqlite3_file* const f, const void* const data,
+      const int size, const sqlite3_int64 offset)
+    {
+      auto* const fl = file(f);
+      auto* const real = fl->real();
+      if (fl->is_injected) {
+        fl->vfs->writes_.fetch_add(1, std::memory_order_relaxed);
+        fl->vfs->delay(fl->vfs->profile_.write);
+      }
+      return real->pMethods->xWrite(real, data, size, offset);
+    };
+    m.xTruncate = [](sqlite3_file* const f, const sqlite3_int64 size)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xTruncate(real, size);
+    };
+    m.xSync = [](sqlite3_file* const f, const int flags)
+    {
+      auto* const fl = file(f);
+      auto* const real = fl->real();
+      if (fl->is_injected) {
+        fl->vfs->syncs_.fetch_add(1, std::memory_order_relaxed);
+        fl->vfs->delay(fl->vfs->profile_.sync);
+      }
+      return real->pMethods->xSync(real, flags);
+    };
+    m.xFileSize = [](sqlite3_file* const f, sqlite3_int64* const size)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xFileSize(real, size);
+    };
+    m.xLock = [](sqlite3_file* const f, const int lock)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xLock(real, lock);
+    };
+    m.xUnlock = [](sqlite3_file* const f, const int lock)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xUnlock(real, lock);
+    };
+    m.xCheckReservedLock = [](sqlite3_file* const f, int* const result)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xCheckReservedLock(real, result);
+    };
+    m.xFileControl = [](sqlite3_file* const f, const int op, void* const arg)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xFileControl(real, op, arg);
+    };
+    m.xSectorSize = [](sqlite3_file* const f)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xSectorSize(real);
+    };
+    m.xDeviceCharacteristics = [](sqlite3_file* const f)
+    {
+      auto* const real = file(f)->real();
+      return real->pMethods->xDeviceCharacteristics(real);
+    };
+    if (m.iVersion >= 2) {
+      m.xShmMap = [](sqlite3_file* const f, const int region, const int size,
+        const int extend, void volatile** const result)
+      {
+        auto* const real = file(f)->real();
+        return real->pMethods->xShmMap(real, region, size, extend, result);
+      };
+      m.xShmLock = [](sqlite3_file* const f, const int offset, const int n,
+        const int flags)
+      {
+        auto* const real = file(f)->real();
+        return real->pMethods->xShmLock(real, offset, n, flags);
+      };
+      m.xShmBarrier = [](sqlite3_file* const f)
+      {
+        auto* const real = file(f)->real();
+        real->pMethods->xShmBarrier(real);
+      };
+      m.xShmUnmap = [](sqlite3_file* const f, const int is_delete)
+      {
+        auto* const real = file(f)->real();
+        return real->pMethods->xShmUnmap(real, is_delete);
+      };
+    }
+    if (m.iVersion >= 3) {
+      // The memory-mapped reads bypass xRead, so they are not delayed.
+      m.xFetch = [](sqlite3_file* const f, const sqlite3_int64 offset,
+        const int size, void** const result)
+      {
+        auto* const real = file(f)->real();
+        return real->pMethods->xFetch(real, offset, size, result);
+      };
+      m.xUnfetch = [](sqlite3_file* const f, const sqlite3_int64 offset,
+        void* const ptr)
+      {
+        auto* const real = file(f)->real();
+        return real->pMethods->xUnfetch(real, offset, ptr);
+      };
+    }
+    fl->base.pMethods = &m;
+    return r;
+  }
+};
+
+} // namespace dmitigr::sqlixx::test
+
+#endif  // DMITIGR_SQLIXX_TEST_LATENCY_VFS_HPP
@@ -0,0 +1,190 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-replay <capture> <database> [--max-speed]
+//
+// Replays the file written by sqlixx::Capture_writer against the copy of the
+// <database> (<database>.replay, made by using the backup API, so the content
+// of the write-ahead log is copied as well) and reports the distributions of step
+// latencies per statement. The records are replayed sequentially in the
+// order of the capture, thus the replay is deterministic. By default, the
+// original timing is reproduced. With --max-speed the records are replayed
+// without pauses.
+
+#include "sqlixx-benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+int main(const int argc, char* const argv[])
+{
+  namespace chrono = std::chrono;
+  namespace fs = std::filesystem;
+  namespace sqlixx = dmitigr::sqlixx;
+  namespace test = sqlixx::test;
+
+  if (argc < 3 || (argc > 3 && std::strcmp(argv[3], "--max-speed"))) {
+    std::cerr << "usage: " << argv[0]
+              << " <capture> <database> [--max-speed]" << std::endl;
+    return 1;
+  }
+  const bool max_speed = argc > 3;
+
+  try {
+    const fs::path database{argv[2]};
+    fs::path copy{database};
+    copy += ".replay";
+    for (const char* const suffix : {"", "-journal", "-wal", "-shm"})
+      fs::remove(copy.string() + suffix);
+
+    sqlixx::Connection conn{copy, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    if (fs::exists(database)) {
+      const sqlixx::Connection source{database, SQLITE_OPEN_READONLY};
+      auto* const backup = sqlite3_backup_init(conn.handle(), "main",
+        source.handle(), "main");
+      if (!backup)
+        throw std::runtime_error{sqlite3_errmsg(conn.handle())};
+      sqlite3_backup_step(backup, -1);
+      if (const int r = sqlite3_backup_finish(backup); r != SQLITE_OK)
+        throw std::runtime_error{std::string{"cannot copy database: "}
+          .append(sqlite3_errstr(r))};
+    }
+    sqlixx::Capture_reader reader{argv[1]};
+
+    struct Replayed final {
+      sqlixx::Statement statement;
+      std::vector<std::uint64_t>* latencies{};
+    };
+    std::unordered_map<std::uint64_t, Replayed> statements;
+    std::map<std::string, std::vector<std::uint64_t>> latencies;
+    std::vector<std::uint64_t> all_latencies;
+    std::uint64_t records{};
+    std::uint64_t errors{};
+    std::uint64_t mismatches{};
+
+    sqlixx::Capture_record record;
+    const auto start = chrono::steady_clock::now();
+    std::optional<std::uint64_t> first_timestamp;
+    while (reader.next(record)) {
+      ++records;
+      if (!max_speed) {
+        if (!first_timestamp)
+          first_timestamp = record.timestamp;
+        std::this_thread::sleep_until(start +
+          chrono::nanoseconds{record.timestamp - *first_timestamp});
+      }
+
+      if (record.event == sqlixx::Capture_event::prepare) {
+        try {
+          statements[record.statement] = Replayed{
+            conn.prepare(record.bytes, record.flags), &latencies[record.bytes]};
+        } catch (const std::exception& e) {
+          std::cerr << e.what() << std::endl;
+          ++errors;
+        }
+        continue;
+      }
+
+      const auto i = statements.find(record.statement);
+      if (i == statements.cend())
+        continue; // the statement wasn't prepared
+      auto* const handle = i->second.statement.handle();
+      int r{SQLITE_OK};
+      switch (record.event) {
+      case sqlixx::Capture_event::bind:
+        switch (record.value_type) {
+        case sqlixx::Capture_value_type::integer:
+          r = sqlite3_bind_int64(handle, record.index, record.integer);
+          break;
+        case sqlixx::Capture_value_type::real:
+          r = sqlite3_bind_double(handle, record.index, record.real);
+          break;
+        case sqlixx::Capture_value_type::text:
+          r = sqlite3_bind_text64(handle, record.index, record.bytes.data(),
+            record.bytes.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+          break;
+        case sqlixx::Capture_value_type::blob:
+          r = sqlite3_bind_blob64(handle, record.index, record.bytes.data(),
+            record.bytes.size(), SQLITE_TRANSIENT);
+          break;
+        default:
+          r = sqlite3_bind_null(handle, record.index);
+        }
+        break;
+      case sqlixx::Capture_event::clear_bindings:
+        r = sqlite3_clear_bindings(handle);
+        break;
+      case sqlixx::Capture_event::step: {
+        const auto step_start = chrono::steady_clock::now();
+        r = sqlite3_step(handle);
+        const auto latency = static_cast<std::uint64_t>(
+          chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - step_start).count());
+        i->second.latencies->push_back(latency);
+        all_latencies.push_back(latency);
+        if (r != record.result)
+          ++mismatches;
+        if (r == SQLITE_ROW || r == SQLITE_DONE)
+          r = SQLITE_OK;
+        break;
+      }
+      case sqlixx::Capture_event::reset:
+        sqlite3_reset(handle);
+        break;
+      case sqlixx::Capture_event::finalize:
+        statements.erase(i);
+        break;
+      case sqlixx::Capture_event::prepare:
+        break;
+      }
+      if (r != SQLITE_OK)
+        ++errors;
+    }
+    const double seconds = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+
+    std::printf("records: %llu, errors: %llu, step result mismatches: %llu, "
+      "seconds: %.3f\n\n", static_cast<unsigned long long>(records),
+      static_cast<unsigned long long>(errors),
+      static_cast<unsigned long long>(mismatches), seconds);
+    std::printf("%10s %10s %10s %10s %10s %10s  %s\n", "steps", "p50,us",
+      "p90,us", "p99,us", "p999,us", "max,us", "statement");
+    const auto print = [](const test::Latency_stats& s, std::string sql)
+    {
+      std::replace(sql.begin(), sql.end(), '\n', ' ');
+      if (sql.size() > 60)
+        sql.resize(60);
+      std::printf("%10zu %10.1f %10.1f %10.1f %10.1f %10.1f  %s\n",
+        s.count, s.p50, s.p90, s.p99, s.p999, s.max, sql.c_str());
+    };
+    for (auto& [sql, samples] : latencies)
+      print(test::latency_stats(std::move(samples)), sql);
+    print(test::latency_stats(std::move(all_latencies)), "(all)");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
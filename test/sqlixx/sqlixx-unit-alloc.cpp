@@ -0,0 +1,130 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sqlixx-alloc.hpp"
+#include "../../src/base/assert.hpp"
+#include "../../src/sqlixx/sqlixx.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+int main()
+{
+  namespace sqlixx = dmitigr::sqlixx;
+  namespace test = sqlixx::test;
+
+  test::install_sqlite_alloc_counter();
+  sqlixx::Connection c{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY};
+  c.execute("create table tab(id integer primary key, cr real, ct text, cb blob)");
+  c.execute("insert into tab values(1, 1.5, 'one', x'01')");
+
+  // SQLite itself allocates VDBE cursors from the heap upon stepping if it's
+  // compiled without the lookaside memory allocator.
+  const bool is_step_allocation_free =
+    !sqlite3_compileoption_used("OMIT_LOOKASIDE");
+
+  auto ins = c.prepare("insert or replace into tab values(?, ?, ?, ?)");
+  auto sel = c.prepare("select id, cr, ct, cb from tab where id = ?");
+  const std::string_view text{"two"};
+  const char blob_data[] = {1, 2, 3};
+  const sqlixx::Blob blob{blob_data, sizeof(blob_data)};
+
+  // Warm up: the first execution of a statement may allocate.
+  ins.execute(2, 2.5, text, blob);
+  sel.execute(2);
+
+  // Binding.
+  {
+    const auto counts = test::count_allocs([&]
+    {
+      for (int i = 0; i < 100; ++i) {
+        ins.reset();
+        ins.bind(0, 2);
+        ins.bind(1, 2.5);
+        ins.bind(2, text);
+        ins.bind(3, blob);
+        ins.bind_many(2, 2.5, text, blob);
+      }
+    });
+    DMITIGR_ASSERT(!counts.new_count);
+    DMITIGR_ASSERT(!counts.sqlite_malloc_count);
+  }
+
+  // Binding the moved values without copying.
+  {
+    ins.reset();
+    ins.bind(2, std::string{}); // allocates the storage of the moved values
+    std::string big_text(4096, 't');
+    std::vector<std::byte> big_blob(4096, std::byte{0xb});
+    const auto* const big_text_data = big_text.data();
+    const auto counts = test::count_allocs([&]
+    {
+      ins.bind(2, std::move(big_text));
+      ins.bind(3, std::move(big_blob));
+    });
+    DMITIGR_ASSERT(!counts.new_count);
+    DMITIGR_ASSERT(!counts.sqlite_malloc_count);
+    ins.execute();
+    sel.execute([big_text_data](const sqlixx::Statement& s)
+    {
+      const auto t = s.result<std::string_view>(2);
+      DMITIGR_ASSERT(t.size() == 4096 && t.data() != big_text_data);
+      DMITIGR_ASSERT(t == std::string(4096, 't'));
+      const auto b = s.result<std::vector<std::byte>>(3);
+      DMITIGR_ASSERT(b == std::vector<std::byte>(4096, std::byte{0xb}));
+    }, 2);
+  }
+
+  // Binding and stepping.
+  {
+    const auto counts = test::count_allocs([&]
+    {
+      for (int i = 0; i < 100; ++i)
+        ins.execute(2, 2.5, text, blob);
+    });
+    DMITIGR_ASSERT(!counts.new_count);
+    if (is_step_allocation_free)
+      DMITIGR_ASSERT(!counts.sqlite_malloc_count);
+  }
+
+  // Stepping and reading the non-owning results.
+  {
+    int rows{};
+    const auto counts = test::count_allocs([&]
+    {
+      for (int i = 0; i < 100; ++i) {
+        sel.execute([&rows, &blob_data](const sqlixx::Statement& s)
+        {
+          DMITIGR_ASSERT(s.result<int>(0) == 2);
+          DMITIGR_ASSERT(s.result<sqlite3_int64>("id") == 2);
+          DMITIGR_ASSERT(s.result<double>(1) == 2.5);
+          DMITIGR_ASSERT(s.result<std::string_view>(2) == "two");
+          const auto t = s.result<sqlixx::Text_utf8>("ct");
+          DMITIGR_ASSERT(t.size() == 3 && !std::strcmp(t.data(), "two"));
+          const auto b = s.result<sqlixx::Blob>(3);
+          DMITIGR_ASSERT(b.size() == 3 && !std::memcmp(b.data(), blob_data, 3));
+          ++rows;
+        }, 2);
+      }
+    });
+    DMITIGR_ASSERT(rows == 100);
+    DMITIGR_ASSERT(!counts.new_count);
+    if (is_step_allocation_free)
+      DMITIGR_ASSERT(!counts.sqlite_malloc_count);
+  }
+}
@@ -0,0 +1,71 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sqlixx-latency_vfs.hpp"
+#include "../../src/base/assert.hpp"
+#include "../../src/sqlixx/sqlixx.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+int main()
+{
+  namespace chrono = std::chrono;
+  namespace sqlixx = dmitigr::sqlixx;
+  namespace test = sqlixx::test;
+
+  const auto path = std::filesystem::temp_directory_path() /
+    "dmitigr_sqlixx_unit_latency_vfs.db";
+  const auto remove = [&path]
+  {
+    for (const char* const suffix : {"", "-journal", "-wal", "-shm"})
+      std::filesystem::remove(path.string() + suffix);
+  };
+  remove();
+
+  test::Latency_profile profile;
+  profile.short_read_probability = 1;
+  profile.sync.tail_probability = 1;
+  profile.sync.tail = chrono::milliseconds{1};
+  test::Latency_vfs vfs{"dmitigr_sqlixx_unit_latency", profile};
+  const std::string uri{"file:" + path.string() + "?vfs=" + vfs.name()};
+  {
+    sqlixx::Connection c{uri, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
+      SQLITE_OPEN_URI, sqlixx::Connection_options{}.set_synchronous("full")};
+    c.execute("create table tab(id integer primary key, data text)");
+    c.execute("with recursive s(i) as (select 1 union all select i + 1 "
+      "from s where i < 1000) insert into tab select i, printf('%0100d', i) "
+      "from s");
+  }
+  {
+    // Reopen to make the data be read via the VFS.
+    sqlixx::Connection c{uri, SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI};
+    int count{};
+    c.execute([&count](const sqlixx::Statement& s)
+    {
+      count = s.result<int>(0);
+      DMITIGR_ASSERT(s.result<std::string>(1) == std::string(97, '0') + "500");
+    }, "select count(*), max(data) filter (where id = 500) from tab");
+    DMITIGR_ASSERT(count == 1000);
+  }
+  const auto stats = vfs.stats();
+  DMITIGR_ASSERT(stats.reads > 0 && stats.short_reads == stats.reads);
+  DMITIGR_ASSERT(stats.writes > 0);
+  DMITIGR_ASSERT(stats.syncs > 0 && stats.tails == stats.syncs);
+  DMITIGR_ASSERT(stats.injected >= stats.syncs * chrono::milliseconds{1});
+  remove();
+}
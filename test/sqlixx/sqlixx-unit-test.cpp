@@ -17,7 +17,14 @@
 #include "../../src/base/assert.hpp"
 #include "../../src/sqlixx/sqlixx.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <string>
 
 int main()
 {
@@ -61,4 +68,1048 @@ int main()
               << "cb: " << cb << "\n";
   },
   "select * from tab where id >= ? and id < ?", 0, 3);
+
+  // Lookaside memory.
+  {
+    sqlixx::Connection lc{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY,
+      sqlixx::Connection_options{}.set_lookaside(
+        sqlixx::Lookaside_config{256, 64, nullptr})};
+    lc.execute("create table t(id integer primary key)");
+    const auto status = lc.lookaside_status();
+    DMITIGR_ASSERT(status.used_highwater <= 64);
+    if (!sqlite3_compileoption_used("OMIT_LOOKASIDE"))
+      DMITIGR_ASSERT(status.hit > 0);
+  }
+
+  // Connection options.
+  {
+    sqlixx::Connection oc{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY,
+      sqlixx::Connection_options{}.set_synchronous("off").set_cache_size(-4096)
+        .set_busy_timeout(std::chrono::milliseconds{100})};
+    oc.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<int>(0) == 0);
+    }, "pragma synchronous");
+    oc.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<int>(0) == -4096);
+    }, "pragma cache_size");
+  }
+
+  // Statement catalog.
+  {
+    const auto catalog = std::make_shared<const sqlixx::Statement_catalog>(
+      std::vector<sqlixx::Statement_catalog::Entry>{
+        {"select count(*) from tab", 0},
+        {"select ct from tab where id = ?", SQLITE_PREPARE_PERSISTENT}});
+    c.set_statement_catalog(catalog);
+    DMITIGR_ASSERT(c.statement_catalog() == catalog);
+    for (int i = 0; i < 3; ++i) {
+      c.statement(0).execute([](const sqlixx::Statement& s)
+      {
+        DMITIGR_ASSERT(s.result<int>(0) == 3);
+      });
+      c.statement(1).execute([](const sqlixx::Statement& s)
+      {
+        DMITIGR_ASSERT(s.result<std::string_view>(0) == "four");
+      }, 1);
+    }
+    DMITIGR_ASSERT(catalog->prepare_count(0) == 1);
+    DMITIGR_ASSERT(catalog->prepare_count(1) == 1);
+
+    sqlixx::Connection c2{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY};
+    c2.execute("create table tab(id integer primary key, ct text)");
+    c2.set_statement_catalog(catalog);
+    c2.statement(0).execute();
+    DMITIGR_ASSERT(catalog->prepare_count(0) == 2);
+
+    // The failed statement is reset before reuse.
+    c2.set_statement_catalog(std::make_shared<const sqlixx::Statement_catalog>(
+      std::vector<sqlixx::Statement_catalog::Entry>{
+        {"insert into tab values(?, ?)", 0}}));
+    c2.statement(0).execute(1, "a");
+    bool is_failed{};
+    try {
+      c2.statement(0).execute(1, "duplicate");
+    } catch (const sqlixx::Sqlite_exception&) {
+      is_failed = true;
+    }
+    DMITIGR_ASSERT(is_failed);
+    c2.statement(0).execute(2, "b");
+    c2.close();
+    bool is_thrown{};
+    try {
+      c2.statement(0);
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+  }
+
+  // Capture.
+  {
+    const auto path = std::filesystem::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test.capture";
+    {
+      c.set_capture(std::make_shared<sqlixx::Capture_writer>(path));
+      auto st = c.prepare("select ct from tab where id = ? or ct = ?");
+      c.set_capture({});
+      st.execute(1, std::string_view{"five"});
+      st.execute(-2, 3.5);
+    }
+    sqlixx::Capture_reader reader{path};
+    sqlixx::Capture_record r;
+    std::vector<sqlixx::Capture_event> events;
+    while (reader.next(r)) {
+      events.push_back(r.event);
+      if (r.event == sqlixx::Capture_event::prepare)
+        DMITIGR_ASSERT(r.bytes == "select ct from tab where id = ? or ct = ?");
+      else if (r.event == sqlixx::Capture_event::bind && r.index == 1)
+        DMITIGR_ASSERT(r.value_type == sqlixx::Capture_value_type::integer &&
+          (r.integer == 1 || r.integer == -2));
+      else if (r.event == sqlixx::Capture_event::bind && r.index == 2)
+        DMITIGR_ASSERT(
+          (r.value_type == sqlixx::Capture_value_type::text && r.bytes == "five") ||
+          (r.value_type == sqlixx::Capture_value_type::real && r.real == 3.5));
+    }
+    using E = sqlixx::Capture_event;
+    DMITIGR_ASSERT((events == std::vector<E>{E::prepare, E::bind, E::bind,
+      E::step, E::step, E::step, E::reset, E::bind, E::bind, E::step,
+      E::finalize}));
+    std::filesystem::remove(path);
+  }
+
+  // Binding by move.
+  {
+    auto st = c.prepare("select ?, ?");
+    std::string text(1000, 'x');
+    st.bind(0, std::optional<std::string>{std::move(text)});
+    st.bind(1, std::vector<std::byte>{});
+    st.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<std::string>(0) == std::string(1000, 'x'));
+      DMITIGR_ASSERT(s.result<std::vector<std::byte>>(1).empty());
+      DMITIGR_ASSERT(sqlite3_column_type(s.handle(), 1) == SQLITE_BLOB);
+      return false;
+    });
+    bool is_thrown{};
+    try {
+      st.bind(0, std::string(1000, 'y'));
+    } catch (const sqlixx::Sqlite_exception& e) {
+      is_thrown = e.condition().value() == SQLITE_MISUSE;
+    }
+    DMITIGR_ASSERT(is_thrown);
+    st.reset();
+    st.bind(0, 1);
+    st.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<int>(0) == 1);
+    });
+  }
+
+  // Contiguous sequences.
+  {
+    const std::vector<float> floats{1.5f, 2.5f, 3.5f};
+    const std::array<std::int32_t, 2> ints{7, -7};
+    auto st = c.prepare("select ?, ?, ?");
+    st.execute([&](const sqlixx::Statement& s)
+    {
+      const auto fs = s.result<sqlixx::Span<float>>(0);
+      DMITIGR_ASSERT(fs.size() == 3 && fs.size_bytes() == 12);
+      DMITIGR_ASSERT(std::equal(fs.begin(), fs.end(), floats.begin()));
+      DMITIGR_ASSERT(s.result<std::vector<float>>(0) == floats);
+      DMITIGR_ASSERT((s.result<std::array<std::int32_t, 2>>(1) == ints));
+      DMITIGR_ASSERT(s.result<sqlixx::Span<std::byte>>(2).size() == 5);
+      bool is_thrown{};
+      try {
+        static_cast<void>(s.result<sqlixx::Span<std::int32_t>>(2));
+      } catch (const sqlixx::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+      return false;
+    }, floats, ints, sqlixx::Span<std::byte>{
+      reinterpret_cast<const std::byte*>("bytes"), 5});
+
+    // Misaligned blob.
+    alignas(8) const char buf[1 + sizeof(double)]{};
+    const auto misaligned = sqlixx::Span<double>::from_blob(buf + 1, sizeof(double));
+    DMITIGR_ASSERT(misaligned.is_data_owner() && misaligned[0] == 0);
+    const auto aligned = sqlixx::Span<double>::from_blob(buf, sizeof(double));
+    DMITIGR_ASSERT(!aligned.is_data_owner() && aligned.data() ==
+      reinterpret_cast<const double*>(buf));
+  }
+
+  // Pointers.
+  {
+    const std::map<int, std::string> dictionary{{1, "one"}, {2, "two"}};
+    const auto lookup = [](sqlite3_context* const ctx, int,
+      sqlite3_value** const args)
+    {
+      using Dictionary = const std::map<int, std::string>;
+      if (const auto* const dict = sqlixx::value_pointer<Dictionary>(args[0])) {
+        if (const auto i = dict->find(sqlite3_value_int(args[1]));
+          i != dict->cend())
+          return sqlite3_result_text(ctx, i->second.c_str(), -1, SQLITE_STATIC);
+      } else
+        return sqlite3_result_error(ctx, "invalid dictionary", -1);
+      sqlite3_result_null(ctx);
+    };
+    DMITIGR_ASSERT(sqlite3_create_function_v2(c.handle(), "lookup", 2,
+        SQLITE_UTF8, nullptr, lookup, nullptr, nullptr, nullptr) == SQLITE_OK);
+
+    using Dictionary_pointer = sqlixx::Pointer<const std::map<int, std::string>>;
+    auto st = c.prepare("select lookup(?1, 2), lookup(?1, 3), ?1 is null");
+    st.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<std::string>(0) == "two");
+      DMITIGR_ASSERT(sqlite3_column_type(s.handle(), 1) == SQLITE_NULL);
+      DMITIGR_ASSERT(s.result<int>(2)); // pointers are NULLs for SQL
+    }, Dictionary_pointer{&dictionary});
+
+    // Mismatched pointer type.
+    int number{};
+    bool is_thrown{};
+    try {
+      c.execute("select lookup(?, 1)", sqlixx::Pointer<int>{&number});
+    } catch (const sqlixx::Sqlite_exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+
+    auto pass = c.prepare("select ?");
+    pass.execute([&number](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<sqlixx::Pointer<int>>(0).value == &number);
+      DMITIGR_ASSERT(!s.result<sqlixx::Pointer<double>>(0).value);
+      DMITIGR_ASSERT(s.result<sqlixx::Pointer<const int>>(0).value == &number);
+    }, sqlixx::Pointer<int>{&number});
+
+    // The pointer to const cannot be extracted as the pointer to non-const.
+    const int constant{};
+    pass.execute([&constant](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(!s.result<sqlixx::Pointer<int>>(0).value);
+      DMITIGR_ASSERT(s.result<sqlixx::Pointer<const int>>(0).value == &constant);
+    }, sqlixx::Pointer<const int>{&constant});
+  }
+
+  // Read-only connection.
+  {
+    const auto path = std::filesystem::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test?read_only#.db";
+    std::filesystem::remove(path);
+    {
+      sqlixx::Connection rw{path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+      rw.execute("create table tab(id integer primary key)");
+      rw.execute("insert into tab values(1), (2)");
+    }
+    for (const bool is_immutable : {false, true}) {
+      sqlixx::Read_only_connection ro{path, {}, is_immutable};
+      int count{};
+      ro.execute([&count](const sqlixx::Statement& s)
+      {
+        count = s.result<int>(0);
+      }, "select count(*) from tab");
+      DMITIGR_ASSERT(count == 2);
+      ro.execute([](const sqlixx::Statement& s)
+      {
+        DMITIGR_ASSERT(s.result<int>(0) == 1);
+      }, "pragma query_only");
+      bool is_thrown{};
+      try {
+        ro.prepare("delete from tab");
+      } catch (const sqlixx::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+    std::filesystem::remove(path);
+  }
+
+  // Connection factory.
+  {
+    const auto path = std::filesystem::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test_factory.db";
+    std::filesystem::remove(path);
+    {
+      sqlixx::Connection rw{path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+      rw.execute("create table tab(id integer primary key, ct text)");
+      rw.execute("insert into tab values(1, 'one')");
+    }
+    const auto catalog = std::make_shared<const sqlixx::Statement_catalog>(
+      std::vector<sqlixx::Statement_catalog::Entry>{
+        {"select ct from tab where id = ?", SQLITE_PREPARE_PERSISTENT}});
+    {
+      sqlixx::Connection_factory factory{path.string(), SQLITE_OPEN_READWRITE,
+        sqlixx::Connection_options{}.set_cache_size(-1024), catalog,
+        {"select * from tab"}, 2};
+      for (int i = 0; i < 3; ++i) {
+        auto conn = factory.get();
+        DMITIGR_ASSERT(conn.statement_catalog() == catalog);
+        const auto prepare_count = catalog->prepare_count(0);
+        conn.statement(0).execute([](const sqlixx::Statement& s)
+        {
+          DMITIGR_ASSERT(s.result<std::string_view>(0) == "one");
+        }, 1);
+        DMITIGR_ASSERT(catalog->prepare_count(0) == prepare_count);
+        conn.execute([](const sqlixx::Statement& s)
+        {
+          DMITIGR_ASSERT(s.result<int>(0) == -1024);
+        }, "pragma cache_size");
+      }
+    }
+    {
+      sqlixx::Connection_factory factory{path.string(), SQLITE_OPEN_READWRITE,
+        {}, {}, {"select * from nonexistent"}};
+      bool is_thrown{};
+      try {
+        factory.get();
+      } catch (const sqlixx::Sqlite_exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+    std::filesystem::remove(path);
+  }
+
+  // Bind elision.
+  {
+    const auto path = std::filesystem::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test_elision.capture";
+    {
+      c.set_capture(std::make_shared<sqlixx::Capture_writer>(path));
+      auto st = c.prepare("select ?1 || ?2, ?3, ?4");
+      c.set_capture({});
+      st.set_bind_elision_enabled(true);
+      DMITIGR_ASSERT(st.is_bind_elision_enabled());
+      std::string tenant{"tenant"};
+      const std::optional<double> none;
+      for (int i = 0; i < 10; ++i) {
+        if (i == 5)
+          tenant[0] = 'T'; // modification in place is visible without rebinding
+        st.execute([&tenant, i](const sqlixx::Statement& s)
+        {
+          DMITIGR_ASSERT(s.result<std::string>(0) == tenant + std::to_string(i));
+          DMITIGR_ASSERT(s.result<double>(1) == 1.5);
+          DMITIGR_ASSERT(sqlite3_column_type(s.handle(), 2) == SQLITE_NULL);
+        }, tenant, i, 1.5, none);
+      }
+    }
+
+    sqlixx::Capture_reader reader{path};
+    sqlixx::Capture_record r;
+    int binds[5]{};
+    while (reader.next(r)) {
+      if (r.event == sqlixx::Capture_event::bind)
+        ++binds[r.index];
+    }
+    DMITIGR_ASSERT(binds[1] == 1 && binds[2] == 10 && binds[3] == 1 &&
+      binds[4] == 1);
+    std::filesystem::remove(path);
+  }
+
+  // Result set.
+  {
+    auto st = c.prepare("select ?1 i, 2.5 r, 'text' t, x'0102' b, null n"
+      " union all select ?1 + 1, null, '', x'', 3");
+    sqlixx::Result_set rs{st, 7};
+    DMITIGR_ASSERT(rs.row_count() == 2 && rs.column_count() == 5);
+    DMITIGR_ASSERT(rs.column_name(2) == "t" && rs.column_index("n") == 4);
+    DMITIGR_ASSERT(rs.type(0, 0) == SQLITE_INTEGER && rs.is_null(0, 4));
+    DMITIGR_ASSERT(rs.get<int>(0, 0) == 7 && rs.get<int>(1, "i") == 8);
+    DMITIGR_ASSERT(rs.get<double>(0, 1) == 2.5 && rs.get<int>(0, 1) == 2);
+    DMITIGR_ASSERT(!rs.get<std::optional<double>>(1, 1));
+    DMITIGR_ASSERT(rs.get<std::string_view>(0, 2) == "text");
+    DMITIGR_ASSERT(!std::strcmp(rs.get<sqlixx::Text_utf8>(0, 2).data(), "text"));
+    DMITIGR_ASSERT(rs.get<std::string>(1, 2).empty());
+    const auto b = rs.get<sqlixx::Blob>(0, "b");
+    DMITIGR_ASSERT(b.size() == 2 && static_cast<const char*>(b.data())[1] == 2);
+    DMITIGR_ASSERT(rs.get<std::vector<std::byte>>(1, 3).empty());
+    DMITIGR_ASSERT(rs.get<std::optional<int>>(1, 4) == 3);
+    bool is_thrown{};
+    try {
+      rs.get<int>(0, 2);
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+
+    // The rows can be appended selectively, and the result set is movable.
+    sqlixx::Result_set odd;
+    st.execute([&odd](const sqlixx::Statement& s)
+    {
+      if (s.result<int>(0) % 2)
+        odd.append(s);
+    }, 7);
+    const auto moved = std::move(odd);
+    DMITIGR_ASSERT(moved.row_count() == 1 && moved.get<int>(0, 0) == 7);
+
+    // The columns of the empty result are known.
+    auto none = c.prepare("select 1 one, 2 two where 0");
+    const sqlixx::Result_set empty{none};
+    DMITIGR_ASSERT(empty.is_empty() && empty.column_count() == 2);
+    DMITIGR_ASSERT(empty.column_index("two") == 1);
+
+    // The memory can be reserved in advance.
+    sqlixx::Result_set reserved;
+    reserved.reserve(2, 64);
+    st.execute([&reserved](const sqlixx::Statement& s)
+    {
+      reserved.append(s);
+    }, 7);
+    DMITIGR_ASSERT(reserved.row_count() == 2 && reserved.column_count() == 5);
+    DMITIGR_ASSERT(reserved.get<int>(1, 0) == 8);
+  }
+
+  // Dynamic values.
+  {
+    sqlixx::Connection dst{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY};
+    dst.execute("create table t(a, b, c, d, e)");
+    auto ins = dst.prepare("insert into t values(?, ?, ?, ?, ?)");
+    std::vector<sqlixx::Value> row;
+    c.execute([&](const sqlixx::Statement& s)
+    {
+      row.clear();
+      for (int i = 0; i < s.column_count(); ++i)
+        row.push_back(s.result<sqlixx::Value>(i));
+      ins.execute(row[0], row[1], row[2], row[3], row[4]);
+    }, "select 1, 2.5, 'three', x'04', null union all select 6, 7, 8, 9, 10");
+    DMITIGR_ASSERT(row.size() == 5 && row[0].to_int() == 6);
+
+    dst.execute([](const sqlixx::Statement& s)
+    {
+      const auto a = s.result<sqlixx::Value>(0);
+      const auto b = s.result<sqlixx::Value>(1);
+      auto c = s.result<sqlixx::Value>(2);
+      const auto d = s.result<sqlixx::Value>(3);
+      const auto e = s.result<sqlixx::Value>(4);
+      DMITIGR_ASSERT(a.type() == SQLITE_INTEGER && a.to_int64() == 1);
+      DMITIGR_ASSERT(b.type() == SQLITE_FLOAT && b.to_double() == 2.5);
+      DMITIGR_ASSERT(c.type() == SQLITE_TEXT &&
+        std::string_view{c.to_text().data()} == "three");
+      DMITIGR_ASSERT(d.type() == SQLITE_BLOB && d.to_blob().size() == 1);
+      DMITIGR_ASSERT(e.is_null() && !e.to_int());
+      const auto copy = c;
+      c = sqlixx::Value{};
+      DMITIGR_ASSERT(c.is_null() && !c.handle() && copy.to_text().size() == 5);
+    }, "select * from t where rowid = 1");
+    int count{};
+    dst.execute([&count](const sqlixx::Statement& s)
+    {
+      count = s.result<int>(0);
+    }, "select count(*) from t");
+    DMITIGR_ASSERT(count == 2);
+  }
+
+  // Keyset cursor.
+  {
+    c.execute("create table pages(g integer, id integer, v text,"
+      " primary key(g, id))");
+    for (int i = 0; i < 50; ++i)
+      c.execute("insert into pages values(?, ?, ?)", i % 3, i, std::to_string(i));
+
+    const auto fetch_all = [](sqlixx::Keyset_cursor& cursor)
+    {
+      std::vector<int> result;
+      while (cursor.fetch([&result](const sqlixx::Statement& s)
+      {
+        result.push_back(s.result<int>("id"));
+      }, 0))
+        DMITIGR_ASSERT(result.size() % 7 == 0 || cursor.is_done());
+      return result;
+    };
+    std::vector<int> expected;
+    for (int i = 0; i < 50; i += 3)
+      expected.push_back(i);
+
+    sqlixx::Keyset_cursor cursor{c, "select g, id, v from pages where g = ?",
+      {"id"}, 7};
+    DMITIGR_ASSERT(fetch_all(cursor) == expected && cursor.is_done());
+    cursor.rewind();
+    bool is_thrown{};
+    try {
+      cursor.fetch([](const sqlixx::Statement&){});
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+    cursor.rewind();
+    DMITIGR_ASSERT(fetch_all(cursor) == expected);
+
+    // Numbered parameters of the query.
+    sqlixx::Keyset_cursor numbered{c,
+      "select g, id, v from pages where g = ?2 and id >= ?1", {"id"}, 7};
+    std::vector<int> ids;
+    while (numbered.fetch([&ids](const sqlixx::Statement& s)
+    {
+      ids.push_back(s.result<int>("id"));
+    }, 1, 0));
+    DMITIGR_ASSERT(ids == std::vector<int>(expected.begin() + 1,
+        expected.end()));
+
+    // Composite key.
+    sqlixx::Keyset_cursor all{c, "select g, id from pages", {"g", "id"}, 7};
+    std::vector<std::pair<int, int>> rows;
+    while (all.fetch([&rows](const sqlixx::Statement& s)
+    {
+      rows.emplace_back(s.result<int>(0), s.result<int>(1));
+    }));
+    DMITIGR_ASSERT(rows.size() == 50 && std::is_sorted(rows.begin(), rows.end()));
+
+    // Resuming from the token.
+    cursor.rewind();
+    cursor.fetch([](const sqlixx::Statement&){}, 0);
+    const auto token = cursor.token();
+    DMITIGR_ASSERT(!token.empty() &&
+      token.find_first_of("+/=") == std::string::npos);
+    sqlixx::Keyset_cursor resumed{c, "select g, id, v from pages where g = ?",
+      {"id"}, 7};
+    resumed.set_token(token);
+    DMITIGR_ASSERT(fetch_all(resumed) ==
+      std::vector<int>(expected.begin() + 7, expected.end()));
+    is_thrown = false;
+    try {
+      resumed.set_token(token.substr(0, token.size() - 2));
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+
+    // Descending text key.
+    sqlixx::Keyset_cursor desc{c, "select v, id from pages where g = ?",
+      {"v"}, 7, true};
+    std::vector<std::string> values;
+    while (desc.fetch([&values](const sqlixx::Statement& s)
+    {
+      values.push_back(s.result<std::string>(0));
+    }, 0));
+    DMITIGR_ASSERT(values.size() == expected.size());
+    DMITIGR_ASSERT(std::is_sorted(values.rbegin(), values.rend()));
+  }
+
+  // Script execution.
+  {
+    c.execute_script("create table script(a); ; -- comment\n"
+      "insert into script values(1); insert into script values(2);\n");
+    int sum{};
+    c.execute([&sum](const sqlixx::Statement& s)
+    {
+      sum = s.result<int>(0);
+    }, "select sum(a) from script");
+    DMITIGR_ASSERT(sum == 3);
+  }
+
+  // Migrations.
+  {
+    namespace fs = std::filesystem;
+    const auto root = fs::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test_migrations";
+    fs::remove_all(root);
+    fs::create_directories(root / "v2");
+    const auto write = [](const fs::path& path, const std::string_view sql)
+    {
+      std::ofstream{path, std::ios_base::binary} << sql;
+    };
+    write(root / "0001_users.sql", "create table users(id integer primary key);"
+      "insert into users values(1);");
+    write(root / "0002_names.sql", "alter table users add column name text;");
+
+    sqlixx::Connection db{"", SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY};
+    const auto count = [&db]
+    {
+      int result{};
+      db.execute([&result](const sqlixx::Statement& s)
+      {
+        result = s.result<int>(0);
+      }, "select count(*) from sqlixx_migrations");
+      return result;
+    };
+    sqlixx::Migration_runner runner{root};
+    DMITIGR_ASSERT(runner.migrations().size() == 2);
+    DMITIGR_ASSERT(runner.migrations()[1].version == "0002_names");
+    DMITIGR_ASSERT(runner.run(db) == 2 && count() == 2);
+    DMITIGR_ASSERT(runner.stored_checksum(db) == runner.checksum());
+    DMITIGR_ASSERT(sqlixx::Migration_runner{root}.run(db) == 0);
+
+    // Pending migration.
+    write(root / "v2" / "0001_emails.sql", "alter table users add column email;");
+    sqlixx::Migration_runner runner2{root};
+    DMITIGR_ASSERT(runner2.migrations().back().version == "v2/0001_emails");
+    DMITIGR_ASSERT(runner2.run(db) == 1 && count() == 3);
+    db.execute("insert into users values(2, 'two', 'two@example.com')");
+
+    // Modified migration.
+    write(root / "0002_names.sql", "alter table users add column nick text;");
+    bool is_thrown{};
+    try {
+      sqlixx::Migration_runner{root}.run(db);
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown && !db.is_transaction_active() && count() == 3);
+
+    // The table name is quoted.
+    fs::create_directories(root / "quoted");
+    write(root / "quoted" / "0001_tags.sql", "create table tags(id);");
+    const sqlixx::Migration_runner quoted{root / "quoted", "my \"migrations\""};
+    DMITIGR_ASSERT(quoted.run(db) == 1 && quoted.stored_checksum(db));
+
+    // The root must be a directory.
+    is_thrown = false;
+    try {
+      sqlixx::Migration_runner{root / "0001_users.sql"};
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+    fs::remove_all(root);
+  }
+
+  // File ingestion.
+  {
+    namespace fs = std::filesystem;
+    const auto root = fs::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test_ingestion";
+    fs::remove_all(root);
+    fs::create_directories(root / "sub");
+    for (int i = 0; i < 100; ++i) {
+      const auto path = root / (i % 2 ? "sub" : "") /
+        (std::to_string(i) + ".txt");
+      std::ofstream{path, std::ios_base::binary} << std::string(
+        static_cast<std::size_t>(i), static_cast<char>('a' + i % 26));
+    }
+    std::ofstream{root / "skipped.bin"} << "skipped";
+
+    c.execute("create table files(path text primary key, data blob)");
+    auto insert = c.prepare("insert into files values(?, ?)");
+    sqlixx::File_ingestion_options options;
+    options.extension = ".txt";
+    options.reader_count = 3;
+    options.queue_capacity = 4;
+    options.batch_size = 16;
+    const auto stats = sqlixx::ingest_files(c, insert, root, options);
+    DMITIGR_ASSERT(stats.file_count == 100 && stats.byte_count == 99 * 50);
+    DMITIGR_ASSERT(!c.is_transaction_active());
+    const auto is_released = [&insert]
+    {
+      const std::unique_ptr<char, void(*)(void*)> sql{
+        sqlite3_expanded_sql(insert.handle()), &sqlite3_free};
+      return insert.last_step_result() < 0 &&
+        std::string_view{sql.get()} == "insert into files values(NULL, NULL)";
+    };
+    DMITIGR_ASSERT(is_released());
+    c.execute([](const sqlixx::Statement& s)
+    {
+      DMITIGR_ASSERT(s.result<std::string>(0) == std::string(13, 'n'));
+    }, "select data from files where path = 'sub/13.txt'");
+
+    // Errors are propagated with the current batch rolled back.
+    bool is_thrown{};
+    try {
+      sqlixx::ingest_files(c, insert, root, options); // duplicate paths
+    } catch (const sqlixx::Sqlite_exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown && !c.is_transaction_active() && is_released());
+    fs::remove_all(root);
+  }
+
+  // Blob store.
+  {
+    const auto count = [&c](const char* const table)
+    {
+      int result{};
+      c.execute([&result](const sqlixx::Statement& s)
+      {
+        result = s.result<int>(0);
+      }, std::string{"select count(*) from "}.append(table));
+      return result;
+    };
+    DMITIGR_ASSERT(sqlixx::blob_hash("hello", 5).to_string() ==
+      "029bbd41b3a7d8cb191dae486a901e5b"); // MurmurHash3_x64_128
+
+    sqlixx::Blob_store_options options;
+    options.is_chunking_enabled = true;
+    options.min_chunk_size = 256;
+    options.average_chunk_size = 1024;
+    options.max_chunk_size = 4096;
+    sqlixx::Blob_store store{c, options};
+    std::string content;
+    for (std::uint32_t i = 1; content.size() < 100000;)
+      content += std::to_string(i = i * 1664525 + 1013904223);
+    const auto h1 = store.put(content.data(), content.size());
+    const auto chunk_count = count("sqlixx_blobs_chunks");
+    DMITIGR_ASSERT(chunk_count > 50);
+    DMITIGR_ASSERT(store.put(content.data(), content.size()) == h1);
+    DMITIGR_ASSERT(store.ref_count(h1) == 2 && count("sqlixx_blobs") == 1);
+
+    // The edit in the middle changes only the chunks around it.
+    auto edited = content;
+    edited.insert(50000, "edit");
+    const auto h2 = store.put(edited.data(), edited.size());
+    DMITIGR_ASSERT(h2 != h1 && count("sqlixx_blobs") == 2);
+    DMITIGR_ASSERT(count("sqlixx_blobs_chunks") <= chunk_count + 3);
+    const auto data = store.get(h2);
+    DMITIGR_ASSERT(data && data->size() == edited.size() &&
+      !std::memcmp(data->data(), edited.data(), edited.size()));
+
+    // Releasing.
+    DMITIGR_ASSERT(store.release(h1) && store.release(h1) && !store.release(h1));
+    DMITIGR_ASSERT(!store.get(h1) && store.get(h2));
+    DMITIGR_ASSERT(store.release(h2));
+    DMITIGR_ASSERT(!count("sqlixx_blobs") && !count("sqlixx_blobs_chunks"));
+
+    // Empty content.
+    const auto empty = store.put(sqlixx::Blob{});
+    DMITIGR_ASSERT(store.get(empty) && store.get(empty)->empty());
+
+    // The collisions are detected (simulated by altering the stored data).
+    const auto expect_collision = [&]
+    {
+      bool is_thrown{};
+      try {
+        store.put(content.data(), content.size());
+      } catch (const sqlixx::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown && !c.is_transaction_active());
+    };
+    const auto h3 = store.put(content.data(), content.size());
+    c.execute("update sqlixx_blobs_chunks set data = zeroblob(length(data))");
+    expect_collision(); // content hit
+    c.execute("delete from sqlixx_blobs");
+    expect_collision(); // chunk hit
+    DMITIGR_ASSERT(!store.ref_count(h3));
+    c.execute("delete from sqlixx_blobs_chunks");
+
+    // The average chunk size must be greater than one.
+    options.min_chunk_size = 1;
+    options.average_chunk_size = 1;
+    bool is_thrown{};
+    try {
+      sqlixx::Blob_store{c, options};
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown);
+  }
+
+  // Large object store.
+  {
+    namespace fs = std::filesystem;
+    const auto dir = fs::temp_directory_path() / "dmitigr_sqlixx_unit_test_lobs";
+    fs::remove_all(dir);
+    const auto file_count = [&dir]
+    {
+      return std::distance(fs::directory_iterator{dir}, fs::directory_iterator{});
+    };
+    sqlixx::Lob_store store{c, dir, 1024};
+    const std::string small(100, 's');
+    const std::string large(100000, 'l');
+    const auto small_id = store.put(small.data(), small.size());
+    const auto large_id = store.put(large.data(), large.size());
+    DMITIGR_ASSERT(file_count() == 1);
+    {
+      const auto s = store.get(small_id);
+      DMITIGR_ASSERT(!s.is_mapped() && s.size() == 100 &&
+        !std::memcmp(s.data(), small.data(), 100));
+      auto l = store.get(large_id);
+      DMITIGR_ASSERT(l.size() == large.size() &&
+        !std::memcmp(l.blob().data(), large.data(), large.size()));
+      const auto moved = std::move(l);
+      DMITIGR_ASSERT(moved.size() == large.size() && !l.size());
+    }
+
+    // The rolled back insertion leaves the garbage.
+    c.execute("begin");
+    store.put(large.data(), large.size());
+    c.execute("rollback");
+    DMITIGR_ASSERT(file_count() == 2);
+    DMITIGR_ASSERT(store.collect_garbage() == 1 && file_count() == 1);
+
+    // The rolled back removal keeps the file.
+    c.execute("begin");
+    DMITIGR_ASSERT(store.remove(large_id));
+    c.execute("rollback");
+    DMITIGR_ASSERT(!store.purge() && store.get(large_id).size() == large.size());
+
+    // The truncated file is detected instead of being mapped.
+    const auto lob_count = [&c]
+    {
+      int result{};
+      c.execute([&result](const sqlixx::Statement& s)
+      {
+        result = s.result<int>(0);
+      }, "select count(*) from sqlixx_lobs");
+      return result;
+    };
+    const auto truncated_id = store.put(large.data(), large.size());
+    c.execute([&dir](const sqlixx::Statement& s)
+    {
+      fs::resize_file(dir / s.result<std::string>(0), 10);
+    }, "select file from sqlixx_lobs where id = ?", truncated_id);
+    bool is_thrown{};
+    try {
+      store.get(truncated_id);
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown && store.remove(truncated_id));
+
+    // The failed write leaves neither the row nor the file.
+    const auto row_count = lob_count();
+    fs::rename(dir, dir.string() + ".bak");
+    is_thrown = false;
+    try {
+      store.put(large.data(), large.size());
+    } catch (const std::exception&) {
+      is_thrown = true;
+    }
+    fs::rename(dir.string() + ".bak", dir);
+    DMITIGR_ASSERT(is_thrown && !c.is_transaction_active());
+    DMITIGR_ASSERT(lob_count() == row_count);
+
+    // The committed removal.
+    DMITIGR_ASSERT(store.remove(large_id) && store.remove(small_id));
+    DMITIGR_ASSERT(!store.remove(small_id));
+    DMITIGR_ASSERT(store.purge() == 2 && !file_count());
+    fs::remove_all(dir);
+  }
+
+  // Bulk load session.
+  {
+    const auto scalar = [&c](const std::string& sql)
+    {
+      int result{};
+      c.execute([&result](const sqlixx::Statement& s)
+      {
+        result = s.result<int>(0);
+      }, sql);
+      return result;
+    };
+    c.execute_script("create table bulk(id integer primary key, k text unique,"
+      " v integer); create index bulk_v on bulk(v);"
+      " create table bulk_log(id integer);"
+      " create trigger bulk_ins after insert on bulk"
+      " begin insert into bulk_log values(new.id); end;"
+      " pragma synchronous = full");
+    const auto schema_count = [&scalar]
+    {
+      return scalar("select count(*) from sqlite_master"
+        " where name in ('bulk_v', 'bulk_ins')");
+    };
+    {
+      sqlixx::Bulk_load_session session{c, {"bulk"}};
+      DMITIGR_ASSERT(session.is_active() && session.dropped_objects().size() == 2);
+      DMITIGR_ASSERT(!schema_count() && !scalar("pragma synchronous"));
+      auto inserter = session.inserter("insert into bulk values(?, ?, ?)", 64);
+      for (int i = 0; i < 1000; ++i)
+        inserter.insert(i, std::to_string(i), i % 10);
+      inserter.flush();
+      DMITIGR_ASSERT(inserter.row_count() == 1000);
+      const auto& timings = session.finish();
+      DMITIGR_ASSERT(!session.is_active() && timings.load >= 0);
+    }
+    DMITIGR_ASSERT(schema_count() == 2 && scalar("pragma synchronous") == 2);
+    DMITIGR_ASSERT(!scalar("select count(*) from bulk_log"));
+    DMITIGR_ASSERT(scalar("select count(*) from bulk where v = 3") == 100);
+
+    // The schema is restored upon destruction on failure.
+    try {
+      sqlixx::Bulk_load_session session{c};
+      auto inserter = session.inserter("insert into bulk values(?, ?, ?)");
+      inserter.insert(1, "duplicate", 1);
+    } catch (const sqlixx::Sqlite_exception&) {}
+    DMITIGR_ASSERT(schema_count() == 2 && scalar("pragma synchronous") == 2);
+    DMITIGR_ASSERT(!c.is_transaction_active());
+    DMITIGR_ASSERT(!scalar("select count(*) from sqlite_master"
+        " where name = 'sqlixx_bulk_load_objects'"));
+  }
+
+  // Bulk load session on the database file.
+  {
+    namespace fs = std::filesystem;
+    const auto path = fs::temp_directory_path() /
+      "dmitigr_sqlixx_unit_test_bulk.db";
+    fs::remove(path);
+    sqlixx::Connection db{path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    const auto text = [&db](const std::string& sql)
+    {
+      std::string result;
+      db.execute([&result](const sqlixx::Statement& s)
+      {
+        result = s.result<std::string>(0);
+      }, sql);
+      return result;
+    };
+    db.execute_script("create table t(id integer primary key, v integer);"
+      " create index t_v on t(v); insert into t values(1, 1)");
+    const auto index_count = [&text]
+    {
+      return text("select count(*) from sqlite_master where name = 't_v'");
+    };
+
+    // The transaction active upon destruction is rolled back first.
+    {
+      sqlixx::Bulk_load_session session{db};
+      DMITIGR_ASSERT(text("pragma journal_mode") == "memory");
+      db.execute("begin");
+      db.execute("insert into t values(2, 2)");
+      try {
+        db.execute("insert into t values(1, 1)");
+      } catch (const sqlixx::Sqlite_exception&) {}
+    }
+    DMITIGR_ASSERT(!db.is_transaction_active() && index_count() == "1");
+    DMITIGR_ASSERT(text("pragma journal_mode") == "delete");
+    DMITIGR_ASSERT(text("select count(*) from t") == "1");
+
+    // The objects dropped by the session which is not finished (as if it
+    // crashed) are recreated by the next session.
+    db.execute_script("create table sqlixx_bulk_load_objects(name text primary"
+      " key, type text not null, sql text not null);"
+      " insert into sqlixx_bulk_load_objects"
+      " select name, type, sql from sqlite_master where name = 't_v';"
+      " drop index t_v");
+    {
+      sqlixx::Bulk_load_session session{db, {"other"}};
+      DMITIGR_ASSERT(session.dropped_objects().size() == 1);
+      session.finish();
+    }
+    DMITIGR_ASSERT(index_count() == "1");
+    DMITIGR_ASSERT(text("select count(*) from sqlite_master"
+        " where name = 'sqlixx_bulk_load_objects'") == "0");
+    db.close();
+    fs::remove(path);
+  }
+
+  // Bulk insertion sorted by key.
+  {
+    c.execute("create table sorted(k text unique, n integer, b blob)");
+    const auto check = [&c](const std::size_t memory_budget)
+    {
+      c.execute("delete from sorted");
+      sqlixx::Bulk_sort_options sort;
+      sort.key = {0};
+      sort.memory_budget = memory_budget;
+      sqlixx::Bulk_inserter inserter{c, "insert into sorted values(?, ?, ?)",
+        100, std::move(sort)};
+      const std::array<char, 2> blob{1, 2};
+      std::uint32_t x{1};
+      for (int i = 0; i < 1000; ++i) {
+        x = x * 1664525 + 1013904223;
+        inserter.insert(std::to_string(x), i,
+          i % 2 ? std::optional<std::array<char, 2>>{blob} : std::nullopt);
+      }
+      DMITIGR_ASSERT(!inserter.row_count()); // buffered
+      inserter.flush();
+      DMITIGR_ASSERT(inserter.row_count() == 1000 && !c.is_transaction_active());
+
+      // The rows are inserted in the order of the key.
+      std::string last;
+      int count{};
+      c.execute([&](const sqlixx::Statement& s)
+      {
+        const auto k = s.result<std::string>(0);
+        DMITIGR_ASSERT(last < k);
+        last = k;
+        DMITIGR_ASSERT(s.result<int>(1) % 2 ? s.result<sqlixx::Blob>(2).size() == 2 :
+          sqlite3_column_type(s.handle(), 2) == SQLITE_NULL);
+        ++count;
+      }, "select k, n, b from sorted order by rowid");
+      DMITIGR_ASSERT(count == 1000);
+    };
+    check(std::size_t{1} << 20); // in memory
+    check(4096); // with spilled runs
+
+    // The rest of the buffered rows are discarded if the insertion fails.
+    c.execute("create table sorted_unique(k integer primary key)");
+    sqlixx::Bulk_sort_options sort;
+    sort.key = {0};
+    sort.memory_budget = 256;
+    sqlixx::Bulk_inserter inserter{c, "insert into sorted_unique values(?)",
+      100, std::move(sort)};
+    for (int i = 0; i < 100; ++i)
+      inserter.insert(i);
+    inserter.insert(50);
+    bool is_thrown{};
+    try {
+      inserter.flush();
+    } catch (const sqlixx::Exception&) {
+      is_thrown = true;
+    }
+    DMITIGR_ASSERT(is_thrown && inserter.row_count() == 51);
+    inserter.insert(200);
+    inserter.flush();
+    DMITIGR_ASSERT(inserter.row_count() == 52 && !c.is_transaction_active());
+    int count{};
+    c.execute([&count](const sqlixx::Statement& s)
+    {
+      count = s.result<int>(0);
+    }, "select count(*) from sorted_unique");
+    DMITIGR_ASSERT(count == 52);
+  }
+
+  // Bulk insertion recovers after the failed row.
+  {
+    c.execute("create table unsorted(id integer primary key, t text)");
+    {
+      sqlixx::Bulk_inserter inserter{c, "insert into unsorted values(?, ?)"};
+      inserter.insert(1, "a");
+      bool is_thrown{};
+      try {
+        inserter.insert(1, "duplicate");
+      } catch (const sqlixx::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+      inserter.insert(2, "b");
+      inserter.flush();
+      DMITIGR_ASSERT(inserter.row_count() == 2 && !c.is_transaction_active());
+    }
+    std::string rows;
+    c.execute([&rows](const sqlixx::Statement& s)
+    {
+      rows = s.result<std::string>(0);
+    }, "select group_concat(id || t, ',') from unsorted");
+    DMITIGR_ASSERT(rows == "1a,2b");
+  }
+
+  // Batch execution with isolation of the failing rows.
+  {
+    c.execute("create table batch(id integer primary key, t text not null)");
+    sqlixx::Batch_executor executor{c, "insert into batch values(?, ?)", 64};
+    for (int i = 0; i < 200; ++i) {
+      if (i == 7 || i == 150)
+        executor.execute(i - 1, "duplicate");
+      else if (i == 100)
+        executor.execute(i, std::optional<std::string>{});
+      else
+        executor.execute(i, "value");
+    }
+    executor.flush();
+    DMITIGR_ASSERT(!c.is_transaction_active());
+    DMITIGR_ASSERT(executor.row_count() == 197);
+
+    const auto& failed = executor.failed_rows();
+    DMITIGR_ASSERT(failed.size() == 3);
+    DMITIGR_ASSERT(failed[0].index == 7 && failed[1].index == 100 &&
+      failed[2].index == 150);
+    for (const auto& row : failed) {
+      DMITIGR_ASSERT((row.code & 0xff) == SQLITE_CONSTRAINT);
+      DMITIGR_ASSERT(!row.message.empty() && row.values.size() == 2);
+    }
+    DMITIGR_ASSERT(failed[0].values[0].to_int() == 6);
+    DMITIGR_ASSERT(failed[0].values[1].to_text().data() == std::string_view{"duplicate"});
+    DMITIGR_ASSERT(failed[1].values[1].is_null());
+
+    int count{};
+    c.execute([&count](const sqlixx::Statement& s)
+    {
+      count = s.result<int>(0);
+    }, "select count(*) from batch where t = 'value'");
+    DMITIGR_ASSERT(count == 197);
+    DMITIGR_ASSERT(executor.release_failed_rows().size() == 3);
+    DMITIGR_ASSERT(executor.failed_rows().empty());
+  }
 }
@@ -0,0 +1,429 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Usage: dmitigr_sqlixx-ycsb [options]
+//
+// Options:
+//   --workload=a|b|c|d|e|f (default: a)
+//   --distribution=zipfian|uniform|latest (default: the one of the workload)
+//   --records=N (default: 100000)
+//   --operations=N (default: 100000)
+//   --threads=N (default: 1)
+//   --connections=N (the pool size, default: the number of threads)
+//   --profile=default|fast|durable (default: fast)
+//   --database=PATH (default: dmitigr_sqlixx_ycsb.db in the temp directory)
+//   --json=PATH (write the results as JSON to PATH)
+//
+// The workloads are the standard YCSB core workloads:
+//   a - 50% reads, 50% updates;
+//   b - 95% reads, 5% updates;
+//   c - 100% reads;
+//   d - 95% reads of the latest records, 5% inserts;
+//   e - 95% short scans, 5% inserts;
+//   f - 50% reads, 50% read-modify-writes.
+
+#include "sqlixx-benchmark.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace chrono = std::chrono;
+namespace sqlixx = dmitigr::sqlixx;
+namespace test = sqlixx::test;
+
+constexpr int field_count{10};
+constexpr std::size_t field_length{100};
+
+enum class Operation { read, update, insert, scan, read_modify_write };
+constexpr const char* operation_names[] = {"read", "update", "insert", "scan",
+  "read-modify-write"};
+
+enum class Distribution { zipfian, uniform, latest };
+
+struct Workload final {
+  double read{};
+  double update{};
+  double insert{};
+  double scan{};
+  double read_modify_write{};
+  Distribution distribution{Distribution::zipfian};
+};
+
+Workload workload(const std::string& name)
+{
+  if (name.size() != 1)
+    throw std::runtime_error{"invalid workload " + name};
+
+  switch (name[0]) {
+  case 'a': return {.5, .5, 0, 0, 0, Distribution::zipfian};
+  case 'b': return {.95, .05, 0, 0, 0, Distribution::zipfian};
+  case 'c': return {1, 0, 0, 0, 0, Distribution::zipfian};
+  case 'd': return {.95, 0, .05, 0, 0, Distribution::latest};
+  case 'e': return {0, 0, .05, .95, 0, Distribution::zipfian};
+  case 'f': return {.5, 0, 0, 0, .5, Distribution::zipfian};
+  }
+  throw std::runtime_error{"invalid workload " + name};
+}
+
+sqlixx::Connection_options profile(const std::string& name)
+{
+  using std::chrono::milliseconds;
+  sqlixx::Connection_options result;
+  result.set_busy_timeout(milliseconds{10000});
+  if (name == "default")
+    return result;
+  else if (name == "fast")
+    return result.set_journal_mode("wal").set_synchronous("normal")
+      .set_cache_size(-65536).set_mmap_size(1 << 30);
+  else if (name == "durable")
+    return result.set_journal_mode("wal").set_synchronous("full");
+  throw std::runtime_error{"invalid profile"};
+}
+
+// The scrambled hash of YCSB (FNV-1a 64).
+std::uint64_t fnv_hash(std::uint64_t value) noexcept
+{
+  std::uint64_t result{0xcbf29ce484222325};
+  for (int i = 0; i < 8; ++i) {
+    result ^= value & 0xff;
+    result *= 0x100000001b3;
+    value >>= 8;
+  }
+  return result;
+}
+
+// The Zipfian generator by Gray et al. "Quickly Generating Billion-Record
+// Synthetic Databases" as it's implemented in YCSB.
+class Zipfian final {
+public:
+  explicit Zipfian(const std::uint64_t items, const double theta = .99)
+    : items_{items}
+    , theta_{theta}
+    , alpha_{1 / (1 - theta)}
+    , zetan_{zeta(items, theta)}
+    , eta_{(1 - std::pow(2. / static_cast<double>(items), 1 - theta)) /
+        (1 - zeta(2, theta) / zetan_)}
+  {}
+
+  template<class G>
+  std::uint64_t operator()(G& gen) const
+  {
+    const double u = std::uniform_real_distribution<double>{}(gen);
+    const double uz = u * zetan_;
+    if (uz < 1)
+      return 0;
+    else if (uz < 1 + std::pow(.5, theta_))
+      return 1;
+    return std::min(items_ - 1, static_cast<std::uint64_t>(
+        static_cast<double>(items_) * std::pow(eta_ * u - eta_ + 1, alpha_)));
+  }
+
+private:
+  std::uint64_t items_{};
+  double theta_{};
+  double alpha_{};
+  double zetan_{};
+  double eta_{};
+
+  static double zeta(const std::uint64_t n, const double theta) noexcept
+  {
+    double result{};
+    for (std::uint64_t i = 1; i <= n; ++i)
+      result += 1 / std::pow(static_cast<double>(i), theta);
+    return result;
+  }
+};
+
+// The identifiers of the statement catalog.
+enum Statement_id : std::size_t { read_id, insert_id, scan_id, update_id };
+
+std::shared_ptr<const sqlixx::Statement_catalog> make_catalog()
+{
+  std::vector<sqlixx::Statement_catalog::Entry> entries{
+    {"select * from usertable where ycsb_key = ?", SQLITE_PREPARE_PERSISTENT},
+    {"insert into usertable(ycsb_key, field0) values(?, ?)",
+     SQLITE_PREPARE_PERSISTENT},
+    {"select * from usertable where ycsb_key >= ? order by ycsb_key limit ?",
+     SQLITE_PREPARE_PERSISTENT}};
+  for (int i = 0; i < field_count; ++i)
+    entries.push_back({std::string{"update usertable set field"}
+      .append(std::to_string(i)).append(" = ? where ycsb_key = ?"),
+      SQLITE_PREPARE_PERSISTENT});
+  return std::make_shared<const sqlixx::Statement_catalog>(std::move(entries));
+}
+
+// A trivial blocking pool of warm connections.
+class Pool final {
+public:
+  Pool(const std::filesystem::path& path, const std::size_t size,
+    const sqlixx::Connection_options& options)
+  {
+    sqlixx::Connection_factory factory{path.string(),
+      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, options, make_catalog(),
+      {}, size};
+    for (std::size_t i = 0; i < size; ++i)
+      free_.push_back(factory.get());
+  }
+
+  sqlixx::Connection acquire()
+  {
+    std::unique_lock lk{mutex_};
+    cv_.wait(lk, [this]{ return !free_.empty(); });
+    auto result = std::move(free_.back());
+    free_.pop_back();
+    return result;
+  }
+
+  void release(sqlixx::Connection conn)
+  {
+    {
+      const std::lock_guard lg{mutex_};
+      free_.push_back(std::move(conn));
+    }
+    cv_.notify_one();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<sqlixx::Connection> free_;
+};
+
+std::string key(const std::uint64_t number)
+{
+  char result[32];
+  std::snprintf(result, sizeof(result), "user%020llu",
+    static_cast<unsigned long long>(fnv_hash(number)));
+  return result;
+}
+
+} // namespace
+
+int main(const int argc, char* const argv[])
+{
+  try {
+    std::map<std::string, std::string> args{
+      {"workload", "a"},
+      {"records", "100000"},
+      {"operations", "100000"},
+      {"threads", "1"},
+      {"profile", "fast"},
+      {"database", (std::filesystem::temp_directory_path() /
+          "dmitigr_sqlixx_ycsb.db").string()}};
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg{argv[i]};
+      const auto eq = arg.find('=');
+      if (arg.compare(0, 2, "--") || eq == std::string::npos)
+        throw std::runtime_error{"invalid argument " + arg};
+      args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    const auto wl = workload(args["workload"]);
+    auto distribution = wl.distribution;
+    if (const auto i = args.find("distribution"); i != args.end()) {
+      if (i->second == "zipfian")
+        distribution = Distribution::zipfian;
+      else if (i->second == "uniform")
+        distribution = Distribution::uniform;
+      else if (i->second == "latest")
+        distribution = Distribution::latest;
+      else
+        throw std::runtime_error{"invalid distribution"};
+    }
+    const auto records = std::stoull(args["records"]);
+    const auto operations = std::stoull(args["operations"]);
+    const auto threads = std::stoull(args["threads"]);
+    const auto connections = args.count("connections") ?
+      std::stoull(args["connections"]) : threads;
+    const auto options = profile(args["profile"]);
+    const std::filesystem::path database{args["database"]};
+    if (!records || !threads || !connections)
+      throw std::runtime_error{"invalid number of records, threads or connections"};
+
+    // Load.
+    std::filesystem::remove(database);
+    std::filesystem::remove(database.string() + "-wal");
+    std::filesystem::remove(database.string() + "-shm");
+    const std::string value(field_length, 'x');
+    {
+      sqlixx::Connection conn{database,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, options};
+      std::string sql{"create table usertable(ycsb_key text primary key"};
+      for (int i = 0; i < field_count; ++i)
+        sql.append(", field").append(std::to_string(i)).append(" text");
+      conn.execute(sql.append(") without rowid"));
+
+      sql = "insert into usertable values(?";
+      for (int i = 0; i < field_count; ++i)
+        sql.append(", ?");
+      auto insert = conn.prepare(sql.append(")"));
+      const double seconds = test::measure_seconds([&]
+      {
+        conn.execute("begin");
+        for (std::uint64_t i = 0; i < records; ++i) {
+          insert.reset();
+          insert.bind(0, key(i));
+          for (int j = 1; j <= field_count; ++j)
+            insert.bind(j, std::string_view{value});
+          insert.execute();
+        }
+        conn.execute("commit");
+      });
+      std::printf("load: %llu records in %.3f seconds\n",
+        static_cast<unsigned long long>(records), seconds);
+    }
+
+    // Run.
+    Pool pool{database, connections, options};
+    const Zipfian zipfian{records};
+    std::atomic<std::uint64_t> inserted{records};
+    std::atomic<std::uint64_t> failed{};
+    std::vector<std::vector<std::uint64_t>> latencies[5];
+    for (auto& l : latencies)
+      l.resize(threads);
+    std::vector<std::thread> workers;
+    const auto start = chrono::steady_clock::now();
+    for (std::uint64_t t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t]
+      {
+        std::mt19937_64 gen{t + 1};
+        std::uniform_real_distribution<double> dice;
+        const auto next_key = [&]() -> std::uint64_t
+        {
+          const auto count = inserted.load(std::memory_order_relaxed);
+          switch (distribution) {
+          case Distribution::uniform:
+            return std::uniform_int_distribution<std::uint64_t>{0, count - 1}(gen);
+          case Distribution::latest:
+            return count - 1 - std::min(count - 1, zipfian(gen));
+          case Distribution::zipfian:
+            break;
+          }
+          return fnv_hash(zipfian(gen)) % count;
+        };
+
+        const auto per_thread = operations / threads +
+          (t < operations % threads);
+        for (std::uint64_t i = 0; i < per_thread; ++i) {
+          const double d = dice(gen);
+          const auto op =
+            d < wl.read ? Operation::read :
+            d < wl.read + wl.update ? Operation::update :
+            d < wl.read + wl.update + wl.insert ? Operation::insert :
+            d < wl.read + wl.update + wl.insert + wl.scan ? Operation::scan :
+            Operation::read_modify_write;
+          const auto op_start = chrono::steady_clock::now();
+          auto conn = pool.acquire();
+          try {
+            const auto field = std::uniform_int_distribution<int>{
+              0, field_count - 1}(gen);
+            const auto update = [&](const std::string& k)
+            {
+              conn.statement(update_id + static_cast<std::size_t>(field))
+                .execute(std::string_view{value}, k);
+            };
+            switch (op) {
+            case Operation::read:
+              conn.statement(read_id).execute([](const sqlixx::Statement&){},
+                key(next_key()));
+              break;
+            case Operation::update:
+              update(key(next_key()));
+              break;
+            case Operation::insert:
+              conn.statement(insert_id).execute(key(inserted.fetch_add(1)),
+                std::string_view{value});
+              break;
+            case Operation::scan: {
+              const int length = std::uniform_int_distribution<int>{1, 100}(gen);
+              conn.statement(scan_id).execute([](const sqlixx::Statement&){},
+                key(next_key()), length);
+              break;
+            }
+            case Operation::read_modify_write: {
+              const auto k = key(next_key());
+              conn.execute("begin immediate");
+              conn.with_rollback_on_error([&]
+              {
+                conn.statement(read_id).execute([](const sqlixx::Statement&){}, k);
+                update(k);
+                conn.execute("commit");
+              });
+              break;
+            }
+            }
+          } catch (const std::exception& e) {
+            if (!failed.fetch_add(1))
+              std::cerr << e.what() << std::endl;
+          }
+          pool.release(std::move(conn));
+          latencies[static_cast<int>(op)][t].push_back(static_cast<std::uint64_t>(
+              chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - op_start).count()));
+        }
+      });
+    }
+    for (auto& worker : workers)
+      worker.join();
+    const double seconds = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+
+    std::printf("run: workload %s, %llu operations, %llu threads, "
+      "%llu connections, profile %s\n", args["workload"].c_str(),
+      static_cast<unsigned long long>(operations),
+      static_cast<unsigned long long>(threads),
+      static_cast<unsigned long long>(connections), args["profile"].c_str());
+    std::printf("throughput: %.1f ops/sec, failed: %llu\n\n",
+      static_cast<double>(operations) / seconds,
+      static_cast<unsigned long long>(failed.load()));
+    std::printf("%-18s %10s %10s %10s %10s\n", "operation", "count",
+      "p50,us", "p99,us", "p999,us");
+    std::vector<test::Result> results;
+    for (int i = 0; i < 5; ++i) {
+      std::vector<std::uint64_t> samples;
+      for (const auto& l : latencies[i])
+        samples.insert(samples.end(), l.begin(), l.end());
+      if (samples.empty())
+        continue;
+      const auto s = test::latency_stats(std::move(samples));
+      std::printf("%-18s %10zu %10.1f %10.1f %10.1f\n", operation_names[i],
+        s.count, s.p50, s.p99, s.p999);
+      results.push_back({std::string{"ycsb/"}.append(args["workload"])
+        .append("/").append(operation_names[i]), {s.p50 * 1000}, 0,
+        {{"count", static_cast<double>(s.count)}, {"p50_us", s.p50},
+         {"p99_us", s.p99}, {"p999_us", s.p999},
+         {"throughput", static_cast<double>(operations) / seconds}}});
+    }
+    if (const auto i = args.find("json"); i != args.end())
+      test::write_json(i->second, results);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}